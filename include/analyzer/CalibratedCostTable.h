@@ -0,0 +1,106 @@
+/**
+ *  @file          CalibratedCostTable.h
+ *
+ *  @version       1.0
+ *  @created       03/02/2013 04:12:37 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Cost table measured on the local machine by tools/CostCalibrator.
+ *  It overrides the hand-picked costs in X86CostModel when loaded.
+ *
+ */
+
+#ifndef __CALIBRATEDCOSTTABLE_H_
+#define __CALIBRATEDCOSTTABLE_H_
+
+#include <map>
+#include <utility>
+
+#include "llvm/CodeGen/ValueTypes.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+
+/// A table of (opcode, legalized type) => cost entries. The costs are
+/// normalized so that a scalar i32 'add' costs CostModel::TCC_Basic.
+///
+/// The on-disk format is a plain text file, one entry per line:
+///
+///    OPCODE DSTTYPE [SRCTYPE] COST
+///
+/// where OPCODE is the IR opcode name (e.g., add, fdiv, sext), TYPE is
+/// the EVT string of the legalized type (e.g., i32, f64, v4i32) and 
+/// SRCTYPE is only present for cast instructions. Lines starting with 
+/// '#' are comments.
+class CalibratedCostTable {
+  public:
+    typedef std::pair<unsigned, std::pair<unsigned, unsigned> > KeyTy;
+    typedef std::map<KeyTy, unsigned> TableTy;
+    typedef TableTy::const_iterator const_iterator;
+
+  protected:
+    TableTy Table;
+
+  public:
+    CalibratedCostTable() {}
+
+    /// Load the table from file, return false if the file cannot
+    /// be read or is ill-formatted.
+    bool load(const char *fname);
+
+    /// Write the table in the format accepted by load.
+    void write(raw_ostream & OS) const;
+
+    void set(unsigned Opcode, MVT Dst, unsigned Cost, MVT Src = MVT::Other)
+    {
+      Table[makeKey(Opcode, Dst, Src)] = Cost;
+    }
+
+    /// Look up the calibrated cost. Return -1 if there's no entry.
+    int lookup(unsigned Opcode, MVT Dst, MVT Src = MVT::Other) const
+    {
+      const_iterator I = Table.find(makeKey(Opcode, Dst, Src));
+      if (I == Table.end())
+        return -1;
+      return I->second;
+    }
+
+    bool empty() const { return Table.empty(); }
+    size_t size() const { return Table.size(); }
+
+    const_iterator begin() const { return Table.begin(); }
+    const_iterator end() const { return Table.end(); }
+
+    static bool isCastOpcode(unsigned Opcode);
+    static unsigned parseOpcode(const char *name);
+    static MVT parseType(const char *name);
+
+  protected:
+    static KeyTy makeKey(unsigned Opcode, MVT Dst, MVT Src)
+    {
+      return std::make_pair(Opcode, std::make_pair((unsigned) Dst.SimpleTy,
+            (unsigned) Src.SimpleTy));
+    }
+};
+
+} // End of llvm namespace
+
+#endif /* __CALIBRATEDCOSTTABLE_H_ */
@@ -47,10 +47,53 @@
 
 namespace llvm {
 
+#define JUMPTABLE_MIN_CASES 4 // fewest cases to be lowered to a jump table
+
+#define JUMPTABLE_MIN_DENSITY 40 // percentage of the case range that must be covered
+
+#define LOCKED_INST_COST 12 // a lock-prefixed instruction or full fence
+
+#define AVGINSTBYTES 4 // average size of a machine instruction
+
+#define CALLBYTES 5 // size of a direct call
+
+class MemoryCostAnalysis;
+class LibCallCostDB;
+class ScalarEvolution;
+
 class CostModel {
 
+  protected:
+    const MemoryCostAnalysis * MCA;
+    const LibCallCostDB * LCD;
+    ScalarEvolution * SE;
+    const Function * SEFunc;
+
+    /// The installed ScalarEvolution if I belongs to its function. 
+    /// Instructions of other functions, e.g., reached through a slice,
+    /// must not be queried against its dominator tree and loops.
+    ScalarEvolution * getScalarEvolution(const Instruction * I) const;
+
   public:
-    CostModel() {}
+    CostModel() : MCA(NULL), LCD(NULL), SE(NULL), SEFunc(NULL) {}
+
+    /// Install the memory hierarchy analysis of the function being
+    /// evaluated. Loads and stores inside loops are then charged for
+    /// their cache-line traffic. Pass NULL to disable.
+    void setMemoryCostAnalysis(const MemoryCostAnalysis * analysis) { MCA = analysis; }
+
+    /// Install the cost database of bulk-memory intrinsics and libc
+    /// routines, calls to them are then priced by their size argument.
+    void setLibCallCostDB(const LibCallCostDB * db) { LCD = db; }
+    const LibCallCostDB * getLibCallCostDB() const { return LCD; }
+
+    /// Install the ScalarEvolution of the function F being evaluated to
+    /// derive non-constant size arguments of the calls in F. Pass NULL 
+    /// to disable.
+    void setScalarEvolution(ScalarEvolution * scev, const Function * F = NULL) {
+      SE = scev;
+      SEFunc = F;
+    }
   
     /// \brief Underlying constants for 'cost' values in this interface.
     ///
@@ -158,6 +201,19 @@ class CostModel {
       SK_ExtractSubvector ///< ExtractSubvector Index indicates start offset.
     };
 
+    /// \return The number of scalar or vector registers that the target has.
+    /// If 'Vectors' is true, it returns the number of vector registers. If it is
+    /// set to false, it returns the number of scalar registers.
+    virtual unsigned getNumberOfRegisters(bool Vector) const;
+
+    /// \return The width of the largest scalar or vector register type.
+    virtual unsigned getRegisterBitWidth(bool Vector) const;
+
+    /// \return The maximum unroll factor that the vectorizer should try to
+    /// perform for this target. This number depends on the level of parallelism
+    /// and the number of execution units in the CPU.
+    virtual unsigned getMaximumUnrollFactor() const;
+
     /// \return The expected cost of arithmetic ops, such as mul, xor, fsub, etc.
     virtual unsigned getArithmeticInstrCost(unsigned Opcode, Type *Ty) const;
 
@@ -194,6 +250,17 @@ class CostModel {
     virtual unsigned getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
                                            ArrayRef<Type *> Tys) const;
 
+    /// \returns The expected cost of a switch, which is lowered either to
+    /// a bounds check and an indirect jump through a jump table when the
+    /// cases are dense, or to a balanced tree of compares otherwise.
+    virtual unsigned getSwitchCost(const SwitchInst *SI) const;
+
+    /// \returns The expected cost of atomic read-modify-write, compare and 
+    /// exchange and fence instructions, and the extra cost of atomic loads
+    /// and stores over plain ones.
+    virtual unsigned getAtomicInstrCost(unsigned Opcode, Type *Ty,
+                                        AtomicOrdering Ordering) const;
+
   protected:
     inline bool terminatingBlock(const BasicBlock *BB) const
     {
@@ -202,6 +269,9 @@ class CostModel {
         isa<ResumeInst>(terminator)); 
     }
 
+    unsigned getCallSiteCost(ImmutableCallSite CS) const;
+    unsigned getShuffleVectorCost(const ShuffleVectorInst *SVI) const;
+
   public:
     //Currently only need a virtual interface
     /// Returns the expected cost of the instruction.
@@ -212,6 +282,10 @@ class CostModel {
     virtual unsigned getBasicBlockCost(const BasicBlock *BB) const;
     virtual unsigned getLoopCost(const Loop *L) const;
     virtual unsigned getFunctionCost(Function *F) const;
+
+    /// Returns the estimated size of the machine code of the instruction,
+    /// in bytes. Instructions that fold away in lowering take no space.
+    virtual unsigned getInstructionSize(const Instruction *I) const;
 };
 
 
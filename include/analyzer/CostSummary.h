@@ -0,0 +1,124 @@
+/**
+ *  @file          CostSummary.h
+ *
+ *  @version       1.0
+ *  @created       03/14/2013 03:27:40 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Cost summary of a function, to compare the versions of a function
+ *  before and after a change.
+ *
+ */
+
+#ifndef __COSTSUMMARY_H_
+#define __COSTSUMMARY_H_
+
+#include <map>
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+
+#include "analyzer/CostModel.h"
+#include "commons/LLVMHelper.h"
+
+namespace llvm {
+
+#define UNKNOWNTRIPCOUNT 10 // assumed trip count of a loop whose trip count is unknown
+
+#define INLINEINSTCOST 5 // inliner cost of an instruction, as in LLVM's InlineConstants
+
+#define INLINECALLPENALTY 25 // additional inliner cost of a call
+
+#define CODEGROWTHBYTES 256 // code growth, in bytes, that matters to the icache
+
+struct InlineThreshold {
+  const char * Name;
+  unsigned Cost;
+};
+
+#define INLINETHRESHOLDS 4
+extern const InlineThreshold InlineThresholds[INLINETHRESHOLDS];
+
+struct FunctionCostSummary {
+  unsigned StaticCost;      // cost of the most expensive path
+  double WeightedCost;      // instruction costs weighted by the loop trip counts
+  unsigned ExpensiveCalls;  // calls to expensive functions
+  unsigned FrequentCalls;   // calls to profile-listed frequent functions
+  unsigned CodeSize;        // estimated machine code size in bytes
+  unsigned InlineCost;      // size of the function as the inliner sees it
+
+  FunctionCostSummary() : StaticCost(0), WeightedCost(0), ExpensiveCalls(0), 
+    FrequentCalls(0), CodeSize(0), InlineCost(0) {}
+
+  /// Whether this summary is no worse than the Base one
+  bool noWorseThan(const FunctionCostSummary & Base) const
+  {
+    return StaticCost <= Base.StaticCost && WeightedCost <= Base.WeightedCost &&
+      ExpensiveCalls <= Base.ExpensiveCalls && FrequentCalls <= Base.FrequentCalls &&
+      CodeSize <= Base.CodeSize;
+  }
+};
+
+typedef std::map<const Function *, FunctionCostSummary> CostSummaryMapTy;
+
+void printCostDelta(const char * funcname, const FunctionCostSummary & Before,
+    const FunctionCostSummary & After);
+
+/// The lowest inlining threshold that the function was below Before
+/// the change and no longer is After it, or NULL if none.
+const InlineThreshold * lostInlineThreshold(const FunctionCostSummary & Before,
+    const FunctionCostSummary & After);
+
+struct CostSummaryPass : public FunctionPass {
+  private:
+    CostModel * cost_model;
+    Profile * profile;
+    CostSummaryMapTy & Summaries;
+
+  public:
+  static char ID;
+  static const char * PassName; 
+
+  CostSummaryPass(CostModel * model, Profile * profile, CostSummaryMapTy & Summaries) : 
+    FunctionPass(ID), cost_model(model), profile(profile), Summaries(Summaries)
+  {
+    assert(cost_model && "Cost model cannot be NULL");
+  }
+
+  virtual bool runOnFunction(Function &F);
+  virtual const char * getPassName() const { return PassName; }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+    AU.addRequired<LoopInfo>();
+    AU.addRequired<ScalarEvolution>(); 
+  }
+
+  protected:
+    unsigned getTripCount(Loop * L, ScalarEvolution * SE);
+    bool inProfile(const Function * F, SpeFuncType type);
+};
+
+} // End of llvm namespace
+
+#endif /* __COSTSUMMARY_H_ */
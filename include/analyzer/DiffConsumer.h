@@ -14,6 +14,9 @@
 #ifndef _LLVM_DIFFCONSUMER_H_
 #define _LLVM_DIFFCONSUMER_H_
 
+#include <utility>
+#include <vector>
+
 #include "DiffLog.h"
 
 #include "llvm/ADT/SmallVector.h"
@@ -48,6 +51,13 @@ namespace llvm {
     /// Record a line-by-line instruction diff.
     virtual void logd(const DiffLogBuilder &Log) = 0;
     virtual void setDiff(bool diff) = 0;
+
+    /// Whether any difference has been recorded.
+    virtual bool hadDifferences() const = 0;
+
+    /// Whether the engine may stop diffing at the first difference,
+    /// when only a yes/no answer is needed.
+    virtual bool stopAtFirstDifference() const { return false; }
   protected:
     virtual ~Consumer() {}
   };
@@ -77,8 +87,8 @@ namespace llvm {
     void indent();
 
   public:
-    DiffConsumer(Module *L, Module *R)
-      : out(errs()), LModule(L), RModule(R), Differences(false), Indent(0) {}
+    DiffConsumer(Module *L, Module *R, raw_ostream &out = errs())
+      : out(out), LModule(L), RModule(R), Differences(false), Indent(0) {}
 
     bool hadDifferences() const;
     void enterContext(Value *L, Value *R);
@@ -88,6 +98,48 @@ namespace llvm {
     void logd(const DiffLogBuilder &Log);
     void setDiff(bool diff) { Differences = diff; }
   };
+
+  /// The differences found in a pair of functions.
+  struct FunctionDiffCount {
+    Function *L;
+    Function *R;
+    unsigned Differences;
+    /// The innermost context of the first difference, e.g., a pair of
+    /// blocks; null if there was no difference.
+    Value *FirstL;
+    Value *FirstR;
+
+    FunctionDiffCount(Function *L, Function *R)
+      : L(L), R(R), Differences(0), FirstL(0), FirstR(0) {}
+  };
+
+  /// A consumer for using the engine as a yes/no filter. It formats
+  /// nothing and keeps no value numberings; it only counts the
+  /// differences of each function and records where the first one is.
+  /// With StopEarly, the engine stops at the first difference.
+  class SummaryConsumer : public Consumer {
+  private:
+    SmallVector<std::pair<Value*, Value*>, 8> contexts;
+    std::vector<FunctionDiffCount> counts;
+    int Current; // index in counts of the function being diffed, or -1
+    bool Differences;
+    bool StopEarly;
+
+  public:
+    /// Room for the counts of Reserve functions is allocated upfront.
+    explicit SummaryConsumer(unsigned Reserve, bool StopEarly = true);
+
+    bool hadDifferences() const { return Differences; }
+    bool stopAtFirstDifference() const { return StopEarly; }
+    void enterContext(Value *L, Value *R);
+    void exitContext();
+    void log(StringRef text) {}
+    void logf(const LogBuilder &Log) {}
+    void logd(const DiffLogBuilder &Log) {}
+    void setDiff(bool diff);
+
+    const std::vector<FunctionDiffCount> &getCounts() const { return counts; }
+  };
 }
 
 #endif
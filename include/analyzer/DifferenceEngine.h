@@ -15,8 +15,11 @@
 #ifndef _LLVM_DIFFERENCE_ENGINE_H_
 #define _LLVM_DIFFERENCE_ENGINE_H_
 
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 
@@ -32,6 +35,25 @@ namespace llvm {
   class Twine;
   class Value;
 
+  /// How a function changed between two modules.
+  enum FunctionDiffKind {
+    FunctionIdentical,
+    FunctionRenamed,
+    FunctionChanged,
+    FunctionAdded,
+    FunctionRemoved
+  };
+  const char *toFunctionDiffStr(FunctionDiffKind Kind);
+
+  struct FunctionDiffResult {
+    FunctionDiffKind Kind;
+    std::string LName;  // empty if added
+    std::string RName;  // empty if removed
+
+    FunctionDiffResult(FunctionDiffKind Kind, StringRef LName, StringRef RName)
+      : Kind(Kind), LName(LName.str()), RName(RName.str()) {}
+  };
+
   /// A class for performing structural comparisons of LLVM assembly.
   class DifferenceEngine {
   public:
@@ -63,6 +85,15 @@ namespace llvm {
 
     void diff(Module *L, Module *R);
     void diff(Function *L, Function *R);
+
+    /// Compares every function defined in the two modules instead of
+    /// stopping at the first difference. A function only in one of the
+    /// modules is paired with a function only in the other module that
+    /// is structurally identical or, failing that, the most similar;
+    /// the pair is reported as renamed if it has no differences.
+    void summarize(Module *L, Module *R,
+                   std::vector<FunctionDiffResult> &Results);
+
     void log(StringRef text) {
       consumer.log(text);
     }
@@ -84,10 +115,25 @@ namespace llvm {
 
     void setDiff(bool diff) { consumer.setDiff(diff); }
 
+    /// Whether there is no need to look for more differences.
+    bool shouldStop() const {
+      return consumer.stopAtFirstDifference() && consumer.hadDifferences();
+    }
+
   private:
+    typedef SmallVectorImpl<std::pair<Function*, Function*> > FunctionPairs;
+
+    /// Pairs the functions defined only in one module with their renamed
+    /// counterparts, first by structural hash, then by similarity. The
+    /// pairs are appended to Renamed and removed from LOnly and ROnly.
+    void matchRenamed(SmallVectorImpl<Function*> &LOnly,
+                      SmallVectorImpl<Function*> &ROnly, FunctionPairs &Renamed);
+
     LLVMContext &context;
     Consumer &consumer;
     Oracle *globalValueOracle;
+    /// Renamed functions, equivalent as operands despite their names
+    DenseMap<GlobalValue*, GlobalValue*> renamed;
   };
 }
 
@@ -40,6 +40,7 @@
 
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/DominanceFrontier.h"
+#include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
@@ -58,9 +59,13 @@
 #include "llvmslicer/StaticSlicer.h"
 
 #include <map>
+#include <vector>
 
 namespace llvm {
 
+class RegisterPressureAnalysis;
+class HotInfluence;
+
 enum RiskLevel {
   NoRisk = 0,       // e.g., renaming, formatting
   LowRisk,      // e.g., a few number of arithmetic operations in cold path
@@ -150,10 +155,22 @@ class RiskEvaluator: public FunctionPass {
     //LoopInfo * GlobalLI;
     DummyLoopInfo * GlobalLI;
     ScalarEvolution *SE;
+    std::vector<Module *> base_modules; // modules before the change
+    std::map<const Function *, RiskLevel> risk_caps;
+    std::map<const Function *, RiskLevel> risk_floors;
     unsigned AllRiskStat[RISKLEVELS];
     unsigned FuncRiskStat[RISKLEVELS];
     unsigned level; // denote the level of the analysis
     unsigned depth; // denote the depth of tracing up
+    bool removed; // evaluating the code removed by the change
+    double deadline; // in ms since the epoch, 0 for no time budget
+    bool partial; // the deadline passed before all the work was done
+    // risk of the instructions assessed in this run, see assessOnce
+    std::map<std::pair<const Instruction *, unsigned>, RiskLevel> assessed;
+    unsigned reassessed; // assessments saved by the memo
+    const HotInfluence * hot_influence;
+    unsigned FuncHotInfluenced; // modifications feeding hot conditions
+    unsigned AllHotInfluenced;
 
   public:
     static char ID;
@@ -163,7 +180,10 @@ class RiskEvaluator: public FunctionPass {
         Profile * profile = NULL, Module * module = NULL, unsigned level = 1, 
         unsigned depth = 2) : FunctionPass(ID), m_inst_map(inst_map), slicer(slicer),
         cost_model(model), profile(profile), func_manager(NULL), 
-        module(module), LocalLI(NULL), SE(NULL), level(level), depth(depth)
+        module(module), LocalLI(NULL), SE(NULL), level(level), depth(depth),
+        removed(false), deadline(0), partial(false), reassessed(0), 
+        hot_influence(NULL),
+        FuncHotInfluenced(0), AllHotInfluenced(0)
     {
       memset(AllRiskStat, 0, sizeof(AllRiskStat));
       memset(FuncRiskStat, 0, sizeof(FuncRiskStat));
@@ -187,9 +207,42 @@ class RiskEvaluator: public FunctionPass {
 
     virtual const char *getPassName() const { return PassName;}
 
+    /// Add a module from before the change, so that the evaluator can
+    /// compare a changed function against its old version.
+    void addBaseModule(Module * M) { base_modules.push_back(M); }
+
+    /// Limit the risk of the modifications in a function, e.g., when
+    /// the function costs no more than its old version.
+    void setRiskCap(const Function * F, RiskLevel cap) { risk_caps[F] = cap; }
+
+    /// Raise the risk of the modifications in a function whose machine
+    /// code grows by growth bytes or no longer fits an inlining threshold,
+    /// weighted by the hotness of the function.
+    void setCodeGrowth(const Function * F, unsigned growth, bool lostInline);
+
+    /// The instructions to evaluate are the ones removed by the change,
+    /// in the before-revision module.
+    void setRemoved(bool r) { removed = r; }
+
+    /// Give up the slices and loop analyses past deadline, in ms since
+    /// the epoch. The modifications themselves are always assessed, and
+    /// the risk found so far is reported and labeled as partial.
+    void setDeadline(double d) { deadline = d; }
+    bool isPartial() const { return partial; }
+
+    /// Label the results as partial and skip the remaining slices and 
+    /// loop analyses, e.g., when the time budget ran out before them.
+    void setPartial() { partial = true; }
+
+    /// Flag the modifications that may change the trip count of a hot
+    /// loop or the direction of a hot branch as high risk at least.
+    void setHotInfluence(const HotInfluence * H) { hot_influence = H; }
+
     virtual bool runOnFunction(Function &F); 
 
     RiskLevel assess(const Instruction *I, std::map<Loop *, unsigned> & LoopDepthMap, Hotness FuncHotness);
+    RiskLevel assessOnce(const Instruction *I, const Function *F,
+        std::map<Loop *, unsigned> & LoopDepthMap, Hotness FuncHotness);
 
     unsigned getLoopDepth(Loop *L, std::map<Loop *, unsigned> & LoopDepthMap);
 
@@ -204,18 +257,28 @@ class RiskEvaluator: public FunctionPass {
 
     bool isPerfSensitive(const BranchInst *I);
 
+    void calcSpillRisk(Function &F, InstVecTy &inst_vec, 
+        SmallPtrSet<const Loop *, 4> &SlowLoops);
+    void calcVectorRisk(Function &F, InstVecTy &inst_vec, 
+        SmallPtrSet<const Loop *, 4> &SlowLoops);
+    RiskLevel assessLoopRegression(const Instruction *I, SmallPtrSet<const Loop *, 4> &SlowLoops, 
+        std::map<Loop *, unsigned> & LoopDepthMap, Hotness FuncHotness);
+
     void clearFuncStat();
     void statFuncRisk(const char * funcname);
     void statAllRisk();
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesAll();
+      AU.addRequired<DominatorTree>();
       AU.addRequired<LoopInfo>();
       AU.addRequired<ScalarEvolution>(); 
       //AU.addRequired<DepGraphBuilder>();
     }
   
   private:
+    Function * getBaseFunction(const Function &F);
+    bool pastDeadline();
     inline void statPrint(unsigned stat[RISKLEVELS]);
 
 };
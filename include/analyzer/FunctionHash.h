@@ -0,0 +1,84 @@
+/**
+ *  @file          FunctionHash.h
+ *
+ *  @version       1.0
+ *  @created       03/11/2013 10:40:19 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Structural hash of a function.
+ *
+ *  The hash ignores value names and debug metadata: local values are
+ *  numbered in the order they are first encountered, global values are
+ *  identified by their names as in the difference engine. Two functions
+ *  that the difference engine would find equivalent hash to the same
+ *  value; functions with equal hashes can be assumed identical.
+ *
+ */
+
+#ifndef __FUNCTIONHASH_H_
+#define __FUNCTIONHASH_H_
+
+#include <stdint.h>
+
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+namespace llvm {
+
+class FunctionHasher {
+  protected:
+    uint64_t Hash;
+    // Local values are numbered by their first occurrence
+    DenseMap<const Value *, unsigned> Numbering;
+    // Hash local operands by their kind only
+    bool Shallow;
+
+  public:
+    FunctionHasher() : Hash(0), Shallow(false) {}
+
+    /// Compute the structural hash of F in a single pass over its
+    /// instructions. Types are hashed structurally, so the hashes of 
+    /// functions from different modules are comparable.
+    uint64_t hash(const Function * F);
+
+    /// Hash the shape of a single instruction: opcode, types, constants
+    /// and globals, but not the identity of its local operands, so that
+    /// instructions of different functions are comparable.
+    uint64_t hashShape(const Instruction * I);
+
+  protected:
+    void add(uint64_t V);
+    void add(StringRef S);
+    void addType(Type * Ty, unsigned Depth = 0);
+    void addValue(const Value * V);
+    void addConstant(const Constant * C);
+    void addInstruction(const Instruction * I);
+    unsigned getNumber(const Value * V);
+};
+
+/// Shorthand for FunctionHasher().hash(F)
+uint64_t hashFunction(const Function * F);
+
+} // End of llvm namespace
+
+#endif /* __FUNCTIONHASH_H_ */
@@ -0,0 +1,89 @@
+/**
+ *  @file          FunctionSimilarity.h
+ *
+ *  @version       1.0
+ *  @created       03/18/2013 02:15:33 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Similarity fingerprints of functions for rename-tolerant matching.
+ *
+ *  A fingerprint is the MinHash signature of the instruction shape
+ *  n-grams in each basic block of a function, so that the fraction of
+ *  equal slots in two signatures estimates the Jaccard similarity of
+ *  the two functions. The index buckets the signatures by bands
+ *  (locality-sensitive hashing), so a query only looks at a bounded
+ *  number of candidates however many functions are indexed.
+ *
+ */
+
+#ifndef __FUNCTIONSIMILARITY_H_
+#define __FUNCTIONSIMILARITY_H_
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "llvm/Function.h"
+
+#define FINGERPRINT_SIZE 32     // number of MinHash slots
+#define FINGERPRINT_BANDS 8     // LSH bands, each of FINGERPRINT_SIZE / FINGERPRINT_BANDS slots
+#define FINGERPRINT_MIN_INSTS 8 // smaller functions are too generic to pair
+#define SIMILARITY_THRESHOLD 0.75
+#define SIMINDEX_MAX_BUCKET 64  // functions kept per bucket
+#define SIMINDEX_MAX_CANDIDATES 256 // candidates compared per query
+
+namespace llvm {
+
+struct FunctionFingerprint {
+  uint32_t MinHash[FINGERPRINT_SIZE];
+  unsigned Size; // number of instructions
+
+  FunctionFingerprint(const Function * F);
+
+  /// Estimated Jaccard similarity of the two functions, in [0, 1]
+  double similarity(const FunctionFingerprint & other) const;
+
+  uint64_t bandKey(unsigned band) const;
+};
+
+class SimilarityIndex {
+  protected:
+    std::vector<Function *> Functions;
+    std::vector<FunctionFingerprint> Prints;
+    std::vector<bool> Taken;
+    std::map<uint64_t, std::vector<unsigned> > Buckets;
+
+  public:
+    /// Index a function definition. Small functions are not indexed.
+    void insert(Function * F);
+
+    /// Find the indexed function most similar to F, or NULL if none is
+    /// similar above SIMILARITY_THRESHOLD. With take set, the returned
+    /// function is not returned again, for one-to-one pairing.
+    Function * findClosest(const Function * F, bool take = true, 
+        double * similarity = NULL);
+
+    unsigned size() const { return Functions.size(); }
+};
+
+} // End of llvm namespace
+
+#endif /* __FUNCTIONSIMILARITY_H_ */
@@ -0,0 +1,115 @@
+/**
+ *  @file          HotInfluence.h
+ *
+ *  @version       1.0
+ *  @created       03/22/2013 04:31:15 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Instructions that decide how often hot code runs: the trip counts of
+ *  hot loops and the direction of hot branches.
+ *
+ *  The conditions of the branches inside hot loops, which include their
+ *  exit conditions, and of the branches of hot functions are collected
+ *  function by function. One backward slice from all of them gives the
+ *  instructions they depend on, once per module.
+ *
+ */
+
+#ifndef __HOTINFLUENCE_H_
+#define __HOTINFLUENCE_H_
+
+#include <map>
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+
+#include "commons/LLVMHelper.h"
+#include "llvmslicer/StaticSlicer.h"
+
+// Loops of unknown trip count are hot from this nesting depth on
+#define HOTLOOPDEPTH 2
+
+namespace llvm {
+
+// Helper pass to collect the conditional branches and switches of a
+// function that lie in a hot loop, or anywhere in a hot function.
+struct HotConditionPass : public FunctionPass {
+  public:
+    typedef SmallVector<Instruction *, 8> InstVecTy;
+    typedef std::map<Function *, InstVecTy> CondMapTy;
+
+  private:
+    Profile * profile;
+    CondMapTy & Conds;
+
+    bool isHotLoop(Loop * L, ScalarEvolution & SE);
+
+  public:
+  static char ID;
+  static const char * PassName; 
+
+  HotConditionPass(Profile * profile, CondMapTy & Conds) : FunctionPass(ID), 
+    profile(profile), Conds(Conds)
+  {
+  }
+
+  virtual bool runOnFunction(Function &F);
+  virtual const char * getPassName() const { return PassName; }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+    AU.addRequired<LoopInfo>();
+    AU.addRequired<ScalarEvolution>();
+  }
+};
+
+class HotInfluence {
+  private:
+    SmallPtrSet<const Instruction *, 64> Influence;
+    unsigned Conditions;
+    bool Partial; // the slice was cut short by the slicer's deadline
+
+  public:
+    /// Slices backward from the hot conditions of M with slicer, which
+    /// must have run on M. The slicer is left slicing forward.
+    HotInfluence(Module * M, slicing::StaticSlicer * slicer, Profile * profile);
+
+    /// Whether I may change the trip count of a hot loop or the direction
+    /// of a hot branch
+    bool influences(const Instruction * I) const { return Influence.count(I); }
+
+    /// Whether the deadline cut the slice short, so that some of the
+    /// instructions the hot conditions depend on are missing
+    bool isPartial() const { return Partial; }
+
+    unsigned getNumConditions() const { return Conditions; }
+    unsigned size() const { return Influence.size(); }
+};
+
+} // End of llvm namespace
+
+#endif /* __HOTINFLUENCE_H_ */
@@ -0,0 +1,109 @@
+/**
+ *  @file          LibCallCost.h
+ *
+ *  @version       1.0
+ *  @created       03/07/2013 02:47:51 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Size-aware cost database for bulk-memory intrinsics and well-known
+ *  libc routines. See data/libcalls for the format.
+ *
+ */
+
+#ifndef __LIBCALLCOST_H_
+#define __LIBCALLCOST_H_
+
+#include <map>
+#include <string>
+
+#include "llvm/Instructions.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+
+namespace llvm {
+
+#define LIBCALL_DEFAULT_SIZE 64 // assumed size when it cannot be derived
+
+#define LIBCALL_MAX_SIZE (1 << 20) // cap of a derived size
+
+#define LIBCALL_RANGE_SIZE 4096 // largest SCEV range bound taken as the size
+
+enum LibCallScale {
+  ConstScale = 0, // BASE
+  LinearScale,    // BASE + FACTOR * n
+  NLogNScale      // BASE + FACTOR * n * log2(n)
+};
+
+struct LibCallCostEntry {
+  unsigned base;
+  double factor;
+  int sizearg;    // index of the size argument, -1 if none
+  int countarg;   // index of an element count multiplying the size, -1 if none
+  LibCallScale scale;
+  LibCallCostEntry() : base(0), factor(0), sizearg(-1), countarg(-1), 
+    scale(ConstScale) {}
+};
+
+class LibCallCostDB {
+  public:
+    typedef std::map<std::string, LibCallCostEntry> DBTy;
+    typedef DBTy::const_iterator const_iterator;
+
+  protected:
+    DBTy DB;
+
+  public:
+    LibCallCostDB() {}
+
+    /// Load the database from file, return false if the file cannot
+    /// be read or is ill-formatted.
+    bool load(const char *fname);
+
+    /// Look up the entry of a function name. Intrinsics are looked up
+    /// by their name without the overloaded type suffix, e.g., llvm.memcpy.
+    const LibCallCostEntry * lookup(StringRef name) const;
+    const LibCallCostEntry * lookup(const CallInst * CI) const;
+
+    /// Estimate the cost of the call from the size argument. The size
+    /// is taken from a constant argument or the range of its SCEV if SE 
+    /// is given; SE must be the one of the function containing CI.
+    /// Returns -1 if the callee is not in the database.
+    unsigned getCallCost(const CallInst * CI, ScalarEvolution * SE = NULL) const;
+
+    /// Estimate the size argument of the call, times the count argument
+    /// if any. Returns 0 if unknown.
+    uint64_t getCallSize(const CallInst * CI, const LibCallCostEntry * entry,
+        ScalarEvolution * SE = NULL) const;
+
+  protected:
+    /// Estimate an integer argument of the call. Returns 0 if unknown.
+    uint64_t getArgSize(const CallInst * CI, int arg, ScalarEvolution * SE) const;
+
+  public:
+
+    bool empty() const { return DB.empty(); }
+    const_iterator begin() const { return DB.begin(); }
+    const_iterator end() const { return DB.end(); }
+};
+
+} // End of llvm namespace
+
+#endif /* __LIBCALLCOST_H_ */
@@ -0,0 +1,82 @@
+/**
+ *  @file          LoopSite.h
+ *
+ *  @version       1.0
+ *  @created       03/10/2013 11:05:21 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Position of a loop in its function, to pair the loops of a changed
+ *  function with the loops of its before-revision version.
+ *
+ */
+
+#ifndef __LOOPSITE_H_
+#define __LOOPSITE_H_
+
+#include <vector>
+
+#include "llvm/BasicBlock.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+
+namespace llvm {
+
+struct LoopSite {
+  const BasicBlock * Header;
+  unsigned Line;    // source line of the loop header, 0 if unknown
+  unsigned Depth;
+
+  LoopSite() : Header(NULL), Line(0), Depth(0) {}
+
+  void setLoop(const Loop * L);
+};
+
+/// Collect the loops of LI in pre-order of the loop nests
+void collectLoops(LoopInfo & LI, std::vector<Loop *> & Loops);
+
+/// The largest constant trip count of L over its exiting blocks, 0 if
+/// none of them is known
+unsigned getMaxTripCount(Loop * L, ScalarEvolution & SE);
+
+/// Find the loop of Before that After, the Idx-th loop of the changed
+/// function, corresponds to: the one at the same line and depth, or at
+/// the same position in the loop nests if line numbers are unknown or
+/// shifted by the change.
+template <class SiteTy>
+const SiteTy * matchLoopSite(const SiteTy & After, unsigned Idx, 
+    const std::vector<SiteTy> & Before)
+{
+  if (After.Line) {
+    for (typename std::vector<SiteTy>::const_iterator I = Before.begin(), 
+        E = Before.end(); I != E; ++I) {
+      if (I->Line == After.Line && I->Depth == After.Depth)
+        return &*I;
+    }
+  }
+  if (Idx < Before.size() && Before[Idx].Depth == After.Depth)
+    return &Before[Idx];
+  return NULL;
+}
+
+} // End of llvm namespace
+
+#endif /* __LOOPSITE_H_ */
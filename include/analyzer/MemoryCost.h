@@ -0,0 +1,94 @@
+/**
+ *  @file          MemoryCost.h
+ *
+ *  @version       1.0
+ *  @created       03/05/2013 10:21:44 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Memory hierarchy cost of loads and stores inside loops.
+ *
+ *  Each access is classified with ScalarEvolution by how its address
+ *  evolves across the iterations of the innermost enclosing loop, and
+ *  the expected number of cache lines it touches per iteration is
+ *  estimated from the stride.
+ *
+ */
+
+#ifndef __MEMORYCOST_H_
+#define __MEMORYCOST_H_
+
+#include "llvm/Instructions.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+
+namespace llvm {
+
+#define CACHELINESIZE 64 // bytes in a cache line
+
+#define CACHELINECOST 16 // cost of bringing in a cache line, in TCC_Basic
+
+enum AccessPattern {
+  NotInLoop = 0,
+  InvariantAccess,  // same address every iteration
+  UnitStrideAccess, // consecutive elements, e.g., a[i]
+  LargeStrideAccess,// constant stride larger than the element or unknown stride
+  NonAffineAccess,  // address not an affine function of the induction variable
+  IndirectAccess    // address loaded in the loop, e.g., p = p->next or a[b[i]]
+};
+
+#define ACCESSPATTERNS 6
+const char * toAccessPatternStr(AccessPattern pattern);
+
+class MemoryCostAnalysis {
+  protected:
+    LoopInfo * LI;
+    ScalarEvolution * SE;
+    unsigned LineSize;
+
+  public:
+    MemoryCostAnalysis(LoopInfo * LI, ScalarEvolution * SE, 
+        unsigned LineSize = CACHELINESIZE) : LI(LI), SE(SE), LineSize(LineSize) 
+    {
+      assert(LI && SE && "Require Loop information and ScalarEvolution");
+    }
+
+    /// Classify the access pattern of a load or store with regard to
+    /// its innermost enclosing loop. Stride is set to the byte stride 
+    /// of the address if it's a constant, 0 otherwise.
+    AccessPattern classify(const Instruction * I, int64_t & Stride) const;
+
+    /// Estimate the number of cache lines the load or store brings
+    /// in per iteration of its innermost loop.
+    double getCacheLinesPerIteration(const Instruction * I) const;
+
+    /// The additional cost of the load or store due to cache-line
+    /// traffic, in units of TCC_Basic.
+    unsigned getMemoryTrafficCost(const Instruction * I) const;
+
+  protected:
+    bool isIndirect(const Value * Ptr, const Loop * L) const;
+    uint64_t getAccessSize(const Instruction * I) const;
+};
+
+} // End of llvm namespace
+
+#endif /* __MEMORYCOST_H_ */
@@ -0,0 +1,129 @@
+/**
+ *  @file          RegisterPressure.h
+ *
+ *  @version       1.0
+ *  @created       03/09/2013 04:12:37 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Register pressure of loops.
+ *
+ *  A conservative liveness analysis estimates the maximum number of
+ *  simultaneously live values in each loop body, split into the general
+ *  purpose and the vector (SIMD and floating point) register files, and
+ *  compares them with the register file of the target to predict spills.
+ *
+ */
+
+#ifndef __REGISTERPRESSURE_H_
+#define __REGISTERPRESSURE_H_
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+
+#include "analyzer/CostModel.h"
+#include "analyzer/LoopSite.h"
+
+namespace llvm {
+
+#define RESERVEDREGS 1 // scalar registers not available to values, e.g., the stack pointer
+
+struct LoopPressure : public LoopSite {
+  unsigned Scalar;  // max live values in general purpose registers
+  unsigned Vector;  // max live values in vector registers
+
+  LoopPressure() : Scalar(0), Vector(0) {}
+};
+
+class RegisterPressureAnalysis {
+  protected:
+    typedef std::set<const Value *> ValueSet;
+    typedef std::map<const BasicBlock *, ValueSet> LiveMapTy;
+    typedef std::map<const BasicBlock *, std::pair<unsigned, unsigned> > BlockPressureTy;
+
+    unsigned NumScalarRegs;
+    unsigned NumVectorRegs;
+    unsigned ScalarWidth;
+    unsigned VectorWidth;
+
+  public:
+    RegisterPressureAnalysis(const CostModel * CM);
+
+    /// Estimate the register pressure of every loop in F. The loops
+    /// are listed in preorder of the loop nest.
+    void analyze(Function & F, LoopInfo & LI, std::vector<LoopPressure> & Result) const;
+
+    /// Find the loop in Before that corresponds to the Idx'th loop
+    /// After the change, see matchLoopSite. Returns NULL if unsure.
+    const LoopPressure * match(const LoopPressure & After, unsigned Idx,
+        const std::vector<LoopPressure> & Before) const;
+
+    /// Number of values that don't fit in the register files and are
+    /// expected to be spilled.
+    unsigned getSpills(const LoopPressure & P) const;
+
+    unsigned getNumberOfRegisters(bool Vector) const
+    {
+      return Vector ? NumVectorRegs : NumScalarRegs;
+    }
+
+  protected:
+    bool isTracked(const Value * V) const;
+    unsigned getRegUnits(Type * Ty, bool & Vector) const;
+    void computeLiveness(Function & F, LiveMapTy & LiveOut) const;
+    void computeBlockPressure(const BasicBlock * BB, const ValueSet & LiveOut,
+        unsigned & Scalar, unsigned & Vector) const;
+    void count(const ValueSet & Live, unsigned & Scalar, unsigned & Vector) const;
+};
+
+// Helper pass to estimate the register pressure of a function outside
+// of the module being evaluated, e.g., the function before the change.
+struct LoopPressurePass : public FunctionPass {
+  private:
+    const RegisterPressureAnalysis * RPA;
+    std::vector<LoopPressure> & Result;
+
+  public:
+  static char ID;
+  static const char * PassName; 
+
+  LoopPressurePass(const RegisterPressureAnalysis * RPA, 
+      std::vector<LoopPressure> & Result) : FunctionPass(ID), RPA(RPA), Result(Result) 
+  {
+  }
+
+  virtual bool runOnFunction(Function &F);
+  virtual const char * getPassName() const { return PassName; }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+    AU.addRequired<LoopInfo>();
+  }
+};
+
+} // End of llvm namespace
+
+#endif /* __REGISTERPRESSURE_H_ */
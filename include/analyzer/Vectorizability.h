@@ -0,0 +1,138 @@
+/**
+ *  @file          Vectorizability.h
+ *
+ *  @version       1.0
+ *  @created       03/20/2013 11:05:47 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Vectorization legality of loops.
+ *
+ *  A simplified version of the checks of a loop vectorizer: the loop
+ *  must be innermost, have a single exit at the latch and a computable
+ *  trip count, contain no calls, and its only recurrences must be
+ *  inductions or reductions. Stores must be consecutive, and must not
+ *  depend on another access to the same object within the vector width
+ *  or possibly alias an access to another object.
+ *
+ */
+
+#ifndef __VECTORIZABILITY_H_
+#define __VECTORIZABILITY_H_
+
+#include <vector>
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+
+#include "analyzer/CostModel.h"
+#include "analyzer/LoopSite.h"
+
+namespace llvm {
+
+enum VectorBlocker {
+  VectorizableLoop = 0,
+  NotInnermostLoop,
+  ComplexControlFlow, // several exits, or memory accesses under a condition
+  UnknownTripCount,
+  CallInLoop,
+  LoopCarriedValue,   // a recurrence that is neither an induction nor a reduction
+  MemoryDependence,   // an access to the stored object within the vector width
+  MayAliasStore,      // a store that may alias an access to another object
+  UnsupportedAccess,  // volatile, atomic or non-consecutive store
+  UnsupportedType,
+  NoVectorUnit
+};
+
+#define VECTORBLOCKERS 11
+const char * toVectorBlockerStr(VectorBlocker blocker);
+
+#define MAXREDUCTIONCHAIN 16 // operations between a reduction phi and its update
+
+struct LoopVectorization : public LoopSite {
+  VectorBlocker Blocker;
+  const Instruction * Culprit; // what blocks the vectorization, if known
+  unsigned Width;   // vectorization factor if vectorizable
+
+  LoopVectorization() : Blocker(VectorizableLoop), Culprit(NULL), Width(0) {}
+
+  bool isVectorizable() const { return Blocker == VectorizableLoop; }
+};
+
+class VectorizationLegality {
+  protected:
+    unsigned VectorWidth;
+
+  public:
+    VectorizationLegality(const CostModel * CM);
+
+    /// Check the vectorization legality of every loop in F. The loops
+    /// are listed in preorder of the loop nest.
+    void analyze(Function & F, LoopInfo & LI, ScalarEvolution & SE, 
+        DominatorTree & DT, std::vector<LoopVectorization> & Result) const;
+
+    /// Find the loop in Before that corresponds to the Idx'th loop
+    /// After the change, see matchLoopSite.
+    const LoopVectorization * match(const LoopVectorization & After, unsigned Idx,
+        const std::vector<LoopVectorization> & Before) const;
+
+  protected:
+    VectorBlocker check(Loop * L, ScalarEvolution & SE, DominatorTree & DT,
+        const Instruction *& Culprit, unsigned & Width) const;
+    VectorBlocker checkMemory(Loop * L, SmallVectorImpl<Instruction *> & Accesses, 
+        ScalarEvolution & SE, unsigned Width, const Instruction *& Culprit) const;
+    bool isInductionOrReduction(PHINode * PN, Loop * L, ScalarEvolution & SE) const;
+};
+
+// Helper pass to check the loops of a function outside of the module
+// being evaluated, e.g., the function before the change.
+struct LoopVectorizationPass : public FunctionPass {
+  private:
+    const VectorizationLegality * VL;
+    std::vector<LoopVectorization> & Result;
+
+  public:
+  static char ID;
+  static const char * PassName; 
+
+  LoopVectorizationPass(const VectorizationLegality * VL, 
+      std::vector<LoopVectorization> & Result) : FunctionPass(ID), VL(VL), Result(Result) 
+  {
+  }
+
+  virtual bool runOnFunction(Function &F);
+  virtual const char * getPassName() const { return PassName; }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+    AU.addRequired<DominatorTree>();
+    AU.addRequired<LoopInfo>();
+    AU.addRequired<ScalarEvolution>();
+  }
+};
+
+} // End of llvm namespace
+
+#endif /* __VECTORIZABILITY_H_ */
@@ -36,6 +36,7 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetLowering.h"
 
+#include "analyzer/CalibratedCostTable.h"
 #include "analyzer/TargetTransformStub.h"
 #include "analyzer/X86SubtargetStub.h"
 #include "analyzer/CostModel.h"
@@ -47,11 +48,17 @@ class X86CostModel : public CostModel {
     X86SubtargetStub * ST;
     VectorTargetTransformStub * VTT;
     const TargetLowering * TLI;
+    CalibratedCostTable * CCT;
 
   public:
     X86CostModel(TargetMachine * TM);
     ~X86CostModel();
 
+    /// Load a cost table measured by the cost calibrator. Calibrated
+    /// entries take precedence over the built-in cost tables.
+    bool loadCostTable(const char *fname);
+    const CalibratedCostTable * getCostTable() const { return CCT; }
+
     virtual unsigned getNumberOfRegisters(bool Vector) const;
     virtual unsigned getRegisterBitWidth(bool Vector) const;
     virtual unsigned getMaximumUnrollFactor() const;
@@ -62,6 +69,8 @@ class X86CostModel : public CostModel {
     virtual unsigned getVectorInstrCost(unsigned Opcode, Type *Val, unsigned Index) const;
     virtual unsigned getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment, 
         unsigned AddressSpace) const;
+    virtual unsigned getAtomicInstrCost(unsigned Opcode, Type *Ty,
+        AtomicOrdering Ordering) const;
 };
 
 } // End of llvm namespace
@@ -4,11 +4,16 @@
 #ifndef SLICING_FUNCTIONSTATICSLICER_H
 #define SLICING_FUNCTIONSTATICSLICER_H
 
+#include <algorithm>
 #include <map>
+#include <vector>
 
 #include "llvm/Value.h"
 #include "llvm/IntrinsicInst.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/DataTypes.h"
 #include "llvm/Support/InstIterator.h"
 
 #include "llvmslicer/PointsTo.h"
@@ -22,10 +27,86 @@ namespace llvm { namespace slicing {
 
   void printVal(const llvm::Value *val);
 
+  /// Dense numbering of the values seen by the slicer of one function
+  class ValueIndex {
+    public:
+      unsigned getId(const llvm::Value *V) {
+        llvm::DenseMap<const llvm::Value *, unsigned>::iterator it = ids.find(V);
+        if (it != ids.end())
+          return it->second;
+        unsigned id = values.size();
+        ids[V] = id;
+        values.push_back(V);
+        return id;
+      }
+      bool findId(const llvm::Value *V, unsigned &id) const {
+        llvm::DenseMap<const llvm::Value *, unsigned>::const_iterator it =
+          ids.find(V);
+        if (it == ids.end())
+          return false;
+        id = it->second;
+        return true;
+      }
+      const llvm::Value *getValue(unsigned id) const { return values[id]; }
+      unsigned size() const { return values.size(); }
+
+    private:
+      llvm::DenseMap<const llvm::Value *, unsigned> ids;
+      std::vector<const llvm::Value *> values;
+  };
+
+  /// Set of value numbers, combined a word at a time
+  class ValBits {
+    public:
+      typedef uint64_t Word;
+      enum { WordBits = 64 };
+
+      bool test(unsigned id) const {
+        return (word(id / WordBits) >> (id % WordBits)) & 1;
+      }
+      bool set(unsigned id) {
+        if (test(id))
+          return false;
+        orWord(id / WordBits, (Word) 1 << (id % WordBits));
+        return true;
+      }
+      bool intersects(const ValBits &RHS) const {
+        unsigned n = std::min(words.size(), RHS.words.size());
+        for (unsigned w = 0; w < n; ++w)
+          if (words[w] & RHS.words[w])
+            return true;
+        return false;
+      }
+      unsigned numWords() const { return words.size(); }
+      Word word(unsigned w) const { return w < words.size() ? words[w] : 0; }
+      void orWord(unsigned w, Word bits) {
+        if (w >= words.size())
+          words.resize(w + 1, 0);
+        words[w] |= bits;
+      }
+
+    private:
+      std::vector<Word> words;
+  };
+
+  /// Summary edge of one argument of a call site: whether the returned
+  /// value and which non-local values the callees define depend on it
+  struct ArgSummary {
+    bool returns;
+    ValSet mods;
+
+    ArgSummary() : returns(false) {}
+  };
+  typedef std::vector<ArgSummary> CallSummary;
+  typedef std::map<const llvm::CallInst *, CallSummary> CallSummaries;
+
+  /// RC, DEF and REF of an instruction are kept both as value lists, for
+  /// the clients, and as bitsets over the function's ValueIndex, for the
+  /// dataflow.
   class InsInfo {
     public:
       InsInfo(const llvm::Instruction *i, const llvm::ptr::PointsToSets &PS,
-          const llvm::mods::Modifies &MOD);
+          const llvm::mods::Modifies &MOD, ValueIndex &index);
 
       const Instruction *getIns() const { return ins; }
 
@@ -40,12 +121,26 @@ namespace llvm { namespace slicing {
         else
           var->dump();
 #endif
+        if (!RCBits.set(index->getId(var)))
+          return false;
         return RC.insert(var); 
       }
-      bool addDEF(const llvm::Value *var) { return DEF.insert(var); }
-      bool addREF(const llvm::Value *var) { return REF.insert(var); }
+      bool addDEF(const llvm::Value *var) {
+        DEFBits.set(index->getId(var));
+        return DEF.insert(var);
+      }
+      bool addREF(const llvm::Value *var) {
+        REFBits.set(index->getId(var));
+        return REF.insert(var);
+      }
+      /// RC |= vals \ mask, returns whether RC grew
+      bool mergeRC(const ValBits &vals, const ValBits *mask = NULL);
       void deslice() { sliced = false; }
 
+      const ValBits &RC_bits() const { return RCBits; }
+      const ValBits &DEF_bits() const { return DEFBits; }
+      const ValBits &REF_bits() const { return REFBits; }
+
       ValSet::const_iterator RC_begin() const { return RC.begin(); }
       ValSet::const_iterator RC_end() const { return RC.end(); }
       ValSet::const_iterator DEF_begin() const { return DEF.begin(); }
@@ -57,21 +152,21 @@ namespace llvm { namespace slicing {
 
     private:
       const llvm::Instruction *ins;
+      ValueIndex *index;
       ValSet RC, DEF, REF;
+      ValBits RCBits, DEFBits, REFBits;
       bool sliced;
   };
 
   class FunctionStaticSlicer {
     public:
-      typedef std::map<const llvm::Instruction *, InsInfo *> InsInfoMap;
+      typedef llvm::DenseMap<const llvm::Instruction *, unsigned> InsIndexMap;
+      typedef llvm::SmallVector<unsigned, 2> EdgeList;
+      typedef llvm::SmallVector<const llvm::BasicBlock *, 4> BlockList;
+      typedef std::map<const llvm::BasicBlock *, BlockList> Frontiers;
 
       FunctionStaticSlicer(llvm::Function &F, llvm::ModulePass *MP,
-          const llvm::ptr::PointsToSets &PT, const llvm::mods::Modifies &mods, bool forward = false) :
-        fun(F), MP(MP), forward(forward) {
-          for (llvm::inst_iterator I = llvm::inst_begin(F), E = llvm::inst_end(F);
-              I != E; ++I)
-            insInfoMap.insert(InsInfoMap::value_type(&*I, new InsInfo(&*I, PT, mods)));
-        }
+          const llvm::ptr::PointsToSets &PT, const llvm::mods::Modifies &mods, bool forward = false);
       ~FunctionStaticSlicer();
 
       ValSet::const_iterator relevant_begin(const llvm::Instruction *I) const {
@@ -137,17 +232,22 @@ namespace llvm { namespace slicing {
         }
         ii->deslice();
       }
+      /// Fetches the analyses the slice needs from the pass manager, which
+      /// must be done before slicers run on several threads
+      void prepareSlice();
+      /// Takes the calls with a summary through their summary edges
+      /// instead of their whole DEF and REF
+      void setSummaries(const CallSummaries *S) { summaries = S; }
       void calculateStaticSlice();
       void dump(bool outputline = false);
       bool slice();
 
       InsInfo *getInsInfo(const llvm::Instruction *i) const {
-        InsInfoMap::const_iterator I = insInfoMap.find(i);
-        if (I == insInfoMap.end()) {
+        InsIndexMap::const_iterator I = insIndex.find(i);
+        if (I == insIndex.end()) {
           return NULL;
         }
-        // assert(I != insInfoMap.end());
-        return I->second;
+        return insInfos[I->second];
       }
 
       static void removeUndefs(ModulePass *MP, Function &F);
@@ -163,22 +263,32 @@ namespace llvm { namespace slicing {
     private:
       llvm::Function &fun;
       llvm::ModulePass *MP;
-      InsInfoMap insInfoMap;
+      ValueIndex values;
+      // instructions numbered by reverse post-order of their blocks
+      InsIndexMap insIndex;
+      std::vector<InsInfo *> insInfos;
+      std::vector<EdgeList> succs, preds;
+      // post-dominance frontiers, for the backward control dependences
+      Frontiers frontiers;
+      bool prepared;
+      const CallSummaries *summaries;
       llvm::SmallSetVector<const llvm::CallInst *, 10> skipAssert;
       bool forward;
 
       static bool sameValues(const Value *val1, const Value *val2);
       void crawlBasicBlock(const llvm::BasicBlock *bb);
       bool computeRCi(InsInfo *insInfoi, InsInfo *insInfoj);
-      bool computeRCi(InsInfo *insInfoi);
+      const CallSummary *getCallSummary(const llvm::Instruction *i) const;
+      bool isRelevant(const ValBits &RC, const llvm::Value *V) const;
+      bool applySummary(InsInfo *ii, const InsInfo *ij, const CallSummary &CS);
       void computeRC();
 
-      void computeSCi(const llvm::Instruction *i, const llvm::Instruction *j);
+      void computeSCi(InsInfo *insInfoi, InsInfo *insInfoj);
       void computeSC();
 
       bool computeBC();
-      bool updateRCSC(llvm::PostDominanceFrontier::DomSetType::const_iterator start,
-          llvm::PostDominanceFrontier::DomSetType::const_iterator end);
+      bool updateRCSC(BlockList::const_iterator start,
+          BlockList::const_iterator end);
 
 
       static void removeUndefBranches(ModulePass *MP, Function &F);
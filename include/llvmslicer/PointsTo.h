@@ -79,10 +79,40 @@ namespace llvm { namespace ptr {
 
 namespace llvm { namespace ptr {
 
+  enum PointsToSolver {
+    PTS_FIXPOINT,   // re-applies every rule in rounds, capped by MAX_IT
+    PTS_WORKLIST,   // inclusion constraints solved to a real fixpoint
+    PTS_UNIFICATION // union-find over equivalence classes, near-linear
+  };
+
+  struct PointsToStats {
+    unsigned Nodes;         // numbered values, including temporaries
+    unsigned Constraints;   // rule codes turned into constraints
+    unsigned Collapsed;     // nodes merged into a cycle representative
+    unsigned Propagations;  // nodes taken off the worklist
+    unsigned SharedSets;    // distinct points-to sets after hash-consing
+
+    PointsToStats() : Nodes(0), Constraints(0), Collapsed(0),
+      Propagations(0), SharedSets(0) {}
+  };
+
   const PointsToSets::PointsToSet &
   getPointsToSet(const llvm::Value *const &memLoc, const PointsToSets &S);
 
-  PointsToSets &computePointsToSets(const ProgramStructure &P, PointsToSets &S);
+  PointsToSets &computePointsToSets(const ProgramStructure &P, PointsToSets &S,
+      PointsToSolver solver = PTS_WORKLIST);
+
+  /// Round-based solver, gives up after maxIt rounds (0 for no limit)
+  PointsToSets &fixpointPointsToSets(const ProgramStructure &P,
+      PointsToSets &S, unsigned maxIt);
+
+  /// Worklist solver with difference propagation and cycle collapsing
+  PointsToSets &solvePointsToSets(const ProgramStructure &P, PointsToSets &S,
+      PointsToStats *stats = NULL);
+
+  /// Steensgaard-style solver, coarser sets in a single pass over the rules
+  PointsToSets &unifyPointsToSets(const ProgramStructure &P, PointsToSets &S,
+      PointsToStats *stats = NULL);
 
 }}
 
@@ -0,0 +1,59 @@
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+
+#ifndef SLICING_SLICERCACHE_H
+#define SLICING_SLICERCACHE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/Value.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/DataTypes.h"
+
+#include "llvmslicer/Modifies.h"
+#include "llvmslicer/PointsTo.h"
+
+namespace llvm { namespace slicing {
+
+  /// On-disk cache of the module-wide results the slicer computes before
+  /// any slice: the points-to sets, the mod sets and the call edges. The
+  /// file is named after a hash of the module bitcode, so a module that
+  /// has not changed since the last run loads them back instead.
+  ///
+  /// Values are stored as their position in a walk over the module, which
+  /// is the same for the same bitcode. The file is a flat array of 32-bit
+  /// words and is read with mmap.
+  class SlicerCache {
+    public:
+      typedef std::multimap<const CallInst *, const Function *> CallEdges;
+
+      SlicerCache(Module &M, const char *dir, unsigned mode);
+
+      bool load(ptr::PointsToSets &PS, mods::Modifies &MOD,
+          CallEdges &calls);
+      bool save(const ptr::PointsToSets &PS, const mods::Modifies &MOD,
+          const CallEdges &calls);
+
+      uint64_t getHash() const { return m_hash; }
+      const std::string &getPath() const { return m_path; }
+
+    private:
+      void number(const Value *V);
+      void numberConstant(const Constant *C);
+      bool getId(const Value *V, uint32_t &id) const;
+
+      Module &m_module;
+      unsigned m_mode;
+      uint64_t m_hash;
+      std::string m_path;
+      std::vector<const Value *> m_values;
+      DenseMap<const Value *, uint32_t> m_ids;
+  };
+
+}}
+
+#endif
@@ -8,6 +8,7 @@
 #include <algorithm>
 
 #include "llvm/ADT/STLExtras.h" /* tie */
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/AliasSetTracker.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/PostDominators.h"
@@ -27,6 +28,43 @@ namespace llvm { namespace slicing {
   typedef llvm::SmallVector<const llvm::Function *, 20> WorkList;
   typedef WorkList::iterator FuncIter;
 
+  /// Functions of a slicing wave, each once and in the order they were
+  /// added. Filled with std::back_inserter by the emitTo* methods.
+  class FuncSet {
+    public:
+      typedef const llvm::Function * value_type;
+      typedef const llvm::Function * const & const_reference;
+      typedef WorkList::const_iterator const_iterator;
+
+      bool insert(const llvm::Function *F) {
+        if (!m_set.insert(F))
+          return false;
+        m_list.push_back(F);
+        return true;
+      }
+      void push_back(const llvm::Function *F) { insert(F); }
+      bool count(const llvm::Function *F) const { return m_set.count(F); }
+      bool empty() const { return m_list.empty(); }
+      void clear() { m_list.clear(); m_set.clear(); }
+      void swap(FuncSet &RHS) {
+        std::swap(m_list, RHS.m_list);
+        std::swap(m_set, RHS.m_set);
+      }
+      const_iterator begin() const { return m_list.begin(); }
+      const_iterator end() const { return m_list.end(); }
+
+    private:
+      WorkList m_list;
+      llvm::SmallPtrSet<const llvm::Function *, 32> m_set;
+  };
+
+  // How the points-to sets used by the slicer are computed
+  enum PointsToMode {
+    PTM_NONE,         // no points-to sets, quick and dirty
+    PTM_UNIFICATION,  // union-find, near-linear but coarse
+    PTM_INCLUSION     // inclusion-based, precise but heavier
+  };
+
   class StaticSlicer : public ModulePass {
     public:
       static char ID;
@@ -37,9 +75,10 @@ namespace llvm { namespace slicing {
         FuncsToCalls;
       typedef std::multimap<llvm::CallInst const*,llvm::Function const*>
         CallsToFuncs;
+      typedef std::map<llvm::Function const*, CallSummary> FuncSummaries;
 
     public:
-      StaticSlicer(bool forward, bool sound = false);
+      StaticSlicer(bool forward, PointsToMode mode = PTM_NONE);
 
       ~StaticSlicer();
 
@@ -71,11 +110,47 @@ namespace llvm { namespace slicing {
         m_initFuns.push_back(F);
       }
 
+      /// Keeps the module-wide results in dir, reused while the module is
+      /// unchanged
+      void setCacheDir(const char *dir) { m_cachedir = dir; }
+
+      /// Number of threads slicing the functions of a wave, 1 to slice
+      /// them one after the other
+      void setThreads(unsigned n) { m_threads = n ? n : 1; }
+
+      /// Crosses calls through summary edges, computed once per function
+      /// and kept for all the criteria, so that a slice only goes back to
+      /// the callers a callee was entered from
+      void setSummaryEdges(bool on) { m_summaryEdges = on; }
+
+      /// Stops extending the slice to more functions past deadline, in ms
+      /// since the epoch, 0 for none
+      void setDeadline(double deadline) { m_deadline = deadline; }
+
+      /// Changes the direction of the next slices. The function slicers
+      /// only live as long as a slice, so it is safe between two of them.
+      void setForward(bool forward) { m_forward = forward; }
+
+      /// Whether the last slice was cut short by the deadline
+      bool isPartial() const { return m_partial; }
+
       void computeSlice();
 
+      /// Returns the next instruction in the slice, or NULL once the slice
+      /// is consumed, at which point the function slicers are released
       const Instruction * next();
+
+      /// Drops the current slice, for a consumer that stops before next()
+      /// returns NULL
+      void releaseSlice();
     private:
       void addInitRC(FunctionStaticSlicer *FSS, const Instruction *inst);
+      bool pastDeadline() const;
+      void sliceWave(const FuncSet &wave);
+      void emitUp(const Function *F, FuncSet &out);
+      void emitDown(const Function *F, FuncSet &out);
+      const CallSummary *summarize(const Function *F);
+      void summarizeCalls(const Function *F);
 
     private:
       typedef llvm::SmallVector<const llvm::Function *, 20> InitFuns;
@@ -85,6 +160,7 @@ namespace llvm { namespace slicing {
       FunctionStaticSlicer * getFSS(const Function * F);
       FunctionStaticSlicer * newFSS(Function * F);
       void buildDicts(const ptr::PointsToSets &PS);
+      void buildModuleInfo(Module &M);
 
       template<typename OutIterator>
         void emitToCalls(llvm::Function const* const f, OutIterator out);
@@ -102,10 +178,10 @@ namespace llvm { namespace slicing {
       bool m_forward;
       Slicers m_slicers;
       InitFuns m_initFuns;
-      WorkList m_sliceFuncs;
+      FuncSet m_sliceFuncs;
       FuncsToCalls m_funcsToCalls;
       CallsToFuncs m_callsToFuncs;
-      FuncIter m_funci;
+      FuncSet::const_iterator m_funci;
       const_inst_iterator m_insti;
       ptr::PointsToSets * m_ps;
       callgraph::Callgraph * m_cg;
@@ -113,7 +189,15 @@ namespace llvm { namespace slicing {
       bool m_criteriaInit;
       bool m_instInit;
       bool m_funcInit;
-      bool m_sound;
+      PointsToMode m_ptmode;
+      const char * m_cachedir;
+      unsigned m_threads;
+      bool m_summaryEdges;
+      double m_deadline;
+      bool m_partial;
+      FuncSummaries m_funcSummaries;
+      CallSummaries m_callSummaries;
+      std::set<const Function *> m_summarizing;
   };
 
 
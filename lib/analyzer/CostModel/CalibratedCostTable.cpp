@@ -0,0 +1,132 @@
+/**
+ *  @file          CalibratedCostTable.cpp
+ *
+ *  @version       1.0
+ *  @created       03/02/2013 04:30:05 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  CalibratedCostTable implementation
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "llvm/Instruction.h"
+
+#include "commons/handy.h"
+#include "analyzer/CalibratedCostTable.h"
+
+using namespace llvm;
+
+bool CalibratedCostTable::isCastOpcode(unsigned Opcode)
+{
+  return Opcode >= Instruction::CastOpsBegin && Opcode < Instruction::CastOpsEnd;
+}
+
+unsigned CalibratedCostTable::parseOpcode(const char *name)
+{
+  for (unsigned Op = Instruction::TermOpsBegin; Op < Instruction::OtherOpsEnd; ++Op) {
+    if (strcmp(name, Instruction::getOpcodeName(Op)) == 0)
+      return Op;
+  }
+  return 0;
+}
+
+MVT CalibratedCostTable::parseType(const char *name)
+{
+  for (unsigned VT = MVT::FIRST_INTEGER_VALUETYPE; VT < MVT::LAST_VALUETYPE; ++VT) {
+    MVT MTy((MVT::SimpleValueType) VT);
+    if (EVT(MTy).getEVTString() == name)
+      return MTy;
+  }
+  return MVT::Other;
+}
+
+bool CalibratedCostTable::load(const char *fname)
+{
+  FILE *fp = fopen(fname, "r");
+  if (fp == NULL) {
+    perror("Read cost table");
+    return false;
+  }
+  char buf[256];
+  unsigned line = 0;
+  while (fgetline(fp, buf, 256) != NULL) {
+    line++;
+    if (isempty(buf) || buf[0] == '#')
+      continue;
+    char *tokens[4];
+    int ntokens = 0;
+    char *str = strtok(buf, " \t");
+    while (str != NULL && ntokens < 4) {
+      tokens[ntokens++] = str;
+      str = strtok(NULL, " \t");
+    }
+    if (str != NULL || ntokens < 3) {
+      syntaxerr("expected OPCODE TYPE [SRCTYPE] COST", line);
+      fclose(fp);
+      return false;
+    }
+    unsigned Opcode = parseOpcode(tokens[0]);
+    if (Opcode == 0) {
+      syntaxerr("unknown opcode", line);
+      fclose(fp);
+      return false;
+    }
+    if (isCastOpcode(Opcode) != (ntokens == 4)) {
+      syntaxerr("source type must be specified only for cast opcodes", line);
+      fclose(fp);
+      return false;
+    }
+    MVT Dst = parseType(tokens[1]);
+    MVT Src = ntokens == 4 ? parseType(tokens[2]) : MVT(MVT::Other);
+    if (Dst == MVT::Other || (ntokens == 4 && Src == MVT::Other)) {
+      syntaxerr("unknown value type", line);
+      fclose(fp);
+      return false;
+    }
+    char *endptr;
+    const char *coststr = tokens[ntokens - 1];
+    unsigned long Cost = strtoul(coststr, &endptr, 10);
+    if (endptr == coststr || *endptr != '\0') {
+      syntaxerr("cost must be a non-negative integer", line);
+      fclose(fp);
+      return false;
+    }
+    set(Opcode, Dst, Cost, Src);
+  }
+  fclose(fp);
+  return true;
+}
+
+void CalibratedCostTable::write(raw_ostream & OS) const
+{
+  for (const_iterator I = Table.begin(), E = Table.end(); I != E; ++I) {
+    unsigned Opcode = I->first.first;
+    MVT Dst((MVT::SimpleValueType) I->first.second.first);
+    MVT Src((MVT::SimpleValueType) I->first.second.second);
+    OS << Instruction::getOpcodeName(Opcode) << " " << EVT(Dst).getEVTString();
+    if (isCastOpcode(Opcode))
+      OS << " " << EVT(Src).getEVTString();
+    OS << " " << I->second << "\n";
+  }
+}
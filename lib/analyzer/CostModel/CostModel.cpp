@@ -38,9 +38,12 @@
 #include "llvm/Analysis/PathNumbering.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CFG.h"
+#include "llvm/Support/MathExtras.h"
 
 #include "analyzer/CostModel.h"
 #include "analyzer/CFGDAG.h"
+#include "analyzer/LibCallCost.h"
+#include "analyzer/MemoryCost.h"
 
 //#define COSTMODEL_DEBUG
 
@@ -125,6 +128,21 @@ unsigned CostModel::getUserCost(const User *U) const
   llvm_unreachable("Unimplemented!");
 }
 
+unsigned CostModel::getNumberOfRegisters(bool Vector) const
+{
+  return 8;
+}
+
+unsigned CostModel::getRegisterBitWidth(bool Vector) const
+{
+  return 32;
+}
+
+unsigned CostModel::getMaximumUnrollFactor() const
+{
+  return 1;
+}
+
 unsigned CostModel::getArithmeticInstrCost(unsigned Opcode, Type *Ty) const 
 {
   return TCC_Basic;
@@ -168,10 +186,106 @@ unsigned CostModel::getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
   return TCC_Basic;
 }
 
+unsigned CostModel::getSwitchCost(const SwitchInst *SI) const
+{
+  // Case 0 is the default destination
+  unsigned NumCases = SI->getNumCases() - 1;
+  if (NumCases == 0)
+    return getCFInstrCost(Instruction::Br);
+
+  if (NumCases < JUMPTABLE_MIN_CASES)
+    // A chain of compare and branch
+    return 2 * TCC_Basic * NumCases;
+
+  APInt Low = SI->getCaseValue(1)->getValue();
+  APInt High = Low;
+  for (unsigned I = 2, E = SI->getNumCases(); I != E; ++I) {
+    const APInt &V = SI->getCaseValue(I)->getValue();
+    if (V.slt(Low))
+      Low = V;
+    if (V.sgt(High))
+      High = V;
+  }
+  uint64_t Range = (High - Low).getLimitedValue() + 1;
+  if (Range != 0 && NumCases * 100 >= Range * JUMPTABLE_MIN_DENSITY)
+    // Bounds check (sub, cmp, br), load from the table and indirect jump
+    return 5 * TCC_Basic;
+
+  // A balanced tree of compare and branch
+  return 2 * TCC_Basic * Log2_32_Ceil(NumCases + 1);
+}
+
+unsigned CostModel::getAtomicInstrCost(unsigned Opcode, Type *Ty,
+  AtomicOrdering Ordering) const
+{
+  switch (Opcode) {
+    case Instruction::AtomicRMW:
+    case Instruction::AtomicCmpXchg:
+    case Instruction::Fence:
+      // Conservatively assume a locked instruction or a full barrier
+      return LOCKED_INST_COST;
+    case Instruction::Load:
+    case Instruction::Store:
+      // Extra cost over a plain load or store
+      if (Ordering > Monotonic)
+        return LOCKED_INST_COST;
+      return TCC_Free;
+    default:
+      llvm_unreachable("Not an atomic instruction!");
+  }
+}
+
+ScalarEvolution * CostModel::getScalarEvolution(const Instruction * I) const
+{
+  if (SE && I->getParent()->getParent() == SEFunc)
+    return SE;
+  return NULL;
+}
+
+unsigned CostModel::getCallSiteCost(ImmutableCallSite CS) const
+{
+  if (LCD && CS.isCall()) {
+    unsigned cost = LCD->getCallCost(cast<CallInst>(CS.getInstruction()), 
+        getScalarEvolution(CS.getInstruction()));
+    if (cost != (unsigned) -1)
+      return cost;
+  }
+  // The target-independent implementation just measures the size of the
+  // function by approximating that each argument will take on average one
+  // instruction to prepare.
+  PointerType *PTy = cast<PointerType>(CS.getCalledValue()->getType());
+  return getCallCost(cast<FunctionType>(PTy->getElementType()), CS.arg_size());
+}
+
+unsigned CostModel::getShuffleVectorCost(const ShuffleVectorInst *SVI) const
+{
+  Type *Ty = SVI->getType();
+  unsigned NumElts = cast<VectorType>(Ty)->getNumElements();
+  bool Broadcast = true, Reverse = true;
+  for (unsigned i = 0; i < NumElts; ++i) {
+    int M = SVI->getMaskValue(i);
+    if (M < 0) // undef
+      continue;
+    if (M != 0)
+      Broadcast = false;
+    if (M != (int) (NumElts - 1 - i))
+      Reverse = false;
+  }
+  if (Broadcast)
+    return getShuffleCost(SK_Broadcast, Ty);
+  // A general permutation takes at least the shuffles of a reverse
+  return getShuffleCost(SK_Reverse, Ty);
+}
+
 unsigned CostModel::getInstructionCost(const Instruction *I) const
 {
   if (isa<IntrinsicInst>(I)) {
-    return TCC_Free; // simply ignore intrinsic instructions
+    if (LCD) {
+      unsigned cost = LCD->getCallCost(cast<CallInst>(I), getScalarEvolution(I));
+      if (cost != (unsigned) -1)
+        return cost;
+    }
+    return TCC_Free; // simply ignore other intrinsic instructions
   }
   switch (I->getOpcode()) {
     case Instruction::Ret:
@@ -179,6 +293,24 @@ unsigned CostModel::getInstructionCost(const Instruction *I) const
     case Instruction::Br: {
       return getCFInstrCost(I->getOpcode());
     }
+    case Instruction::Switch: {
+      return getSwitchCost(cast<SwitchInst>(I));
+    }
+    case Instruction::IndirectBr: {
+      // The indirect jump is hard to predict
+      return getCFInstrCost(I->getOpcode()) + TCC_Basic;
+    }
+    case Instruction::Unreachable: {
+      return TCC_Free;
+    }
+    case Instruction::Unwind:
+    case Instruction::Resume: {
+      // Calls into the unwinder
+      return TCC_Expensive;
+    }
+    case Instruction::LandingPad: {
+      return TCC_Basic;
+    }
     case Instruction::Add:
     case Instruction::FAdd:
     case Instruction::Sub:
@@ -216,15 +348,45 @@ unsigned CostModel::getInstructionCost(const Instruction *I) const
     case Instruction::Store: {
       const StoreInst *SI = cast<StoreInst>(I);
       Type *ValTy = SI->getValueOperand()->getType();
-      return getMemoryOpCost(I->getOpcode(), ValTy,
+      unsigned cost = getMemoryOpCost(I->getOpcode(), ValTy,
                                    SI->getAlignment(),
                                    SI->getPointerAddressSpace());
+      if (SI->isAtomic())
+        cost += getAtomicInstrCost(I->getOpcode(), ValTy, SI->getOrdering());
+      if (MCA)
+        cost += MCA->getMemoryTrafficCost(I);
+      return cost;
     }
     case Instruction::Load: {
       const LoadInst *LI = cast<LoadInst>(I);
-      return getMemoryOpCost(I->getOpcode(), I->getType(),
+      unsigned cost = getMemoryOpCost(I->getOpcode(), I->getType(),
                                   LI->getAlignment(),
                                   LI->getPointerAddressSpace());
+      if (LI->isAtomic())
+        cost += getAtomicInstrCost(I->getOpcode(), I->getType(), LI->getOrdering());
+      if (MCA)
+        cost += MCA->getMemoryTrafficCost(I);
+      return cost;
+    }
+    case Instruction::GetElementPtr: {
+      const GetElementPtrInst *GEP = cast<GetElementPtrInst>(I);
+      SmallVector<const Value *, 4> Indices;
+      for (User::const_op_iterator OI = GEP->idx_begin(), OE = GEP->idx_end();
+          OI != OE; ++OI)
+        Indices.push_back(*OI);
+      return getGEPCost(GEP->getPointerOperand(), Indices);
+    }
+    case Instruction::AtomicRMW: {
+      const AtomicRMWInst *RMWI = cast<AtomicRMWInst>(I);
+      return getAtomicInstrCost(I->getOpcode(), I->getType(), RMWI->getOrdering());
+    }
+    case Instruction::AtomicCmpXchg: {
+      const AtomicCmpXchgInst *CXI = cast<AtomicCmpXchgInst>(I);
+      return getAtomicInstrCost(I->getOpcode(), I->getType(), CXI->getOrdering());
+    }
+    case Instruction::Fence: {
+      const FenceInst *FI = cast<FenceInst>(I);
+      return getAtomicInstrCost(I->getOpcode(), I->getType(), FI->getOrdering());
     }
     case Instruction::ZExt:
     case Instruction::SExt:
@@ -259,12 +421,27 @@ unsigned CostModel::getInstructionCost(const Instruction *I) const
       return getVectorInstrCost(I->getOpcode(),
                                       IE->getType(), Idx);
     }
-    case Instruction::Call: {
-      // The target-independent implementation just measures the size of the
-      // function by approximating that each argument will take on average one
-      // instruction to prepare.
-      const CallInst * CI = cast<CallInst>(I);
-      return TCC_Basic * (CI->getNumArgOperands() + 1);
+    case Instruction::ShuffleVector: {
+      return getShuffleVectorCost(cast<ShuffleVectorInst>(I));
+    }
+    case Instruction::ExtractValue:
+    case Instruction::InsertValue: {
+      // Aggregates live in registers, these are mostly renaming
+      return TCC_Free;
+    }
+    case Instruction::Call:
+    case Instruction::Invoke: {
+      return getCallSiteCost(ImmutableCallSite(I));
+    }
+    case Instruction::VAArg: {
+      // Lowered to a check of the register save area offset and a load
+      // from either the save area or the overflow area.
+      return 4 * TCC_Basic;
+    }
+    case Instruction::UserOp1:
+    case Instruction::UserOp2: {
+      // Only used internally in passes
+      return TCC_Free;
     }
     default:
       // errs() << "Warning: unknown cost for instruction " << I->getOpcode() << "\n";
@@ -346,3 +523,43 @@ unsigned CostModel::getFunctionCost(Function *F) const
   #endif
   return max;
 }
+
+unsigned CostModel::getInstructionSize(const Instruction *I) const
+{
+  if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(I)) {
+    switch (II->getIntrinsicID()) {
+      case Intrinsic::memcpy:
+      case Intrinsic::memmove:
+      case Intrinsic::memset:
+        // Lowered to a libc call unless the size is small and constant
+        return CALLBYTES + AVGINSTBYTES * (II->getNumArgOperands() - 1);
+      default:
+        return 0;
+    }
+  }
+  switch (I->getOpcode()) {
+    case Instruction::PHI:
+    case Instruction::Alloca:
+    case Instruction::BitCast:
+    case Instruction::PtrToInt:
+    case Instruction::IntToPtr:
+    case Instruction::Unreachable:
+      return 0;
+    case Instruction::GetElementPtr:
+      // Constant offsets fold into the addressing mode
+      return cast<GetElementPtrInst>(I)->hasAllConstantIndices() ? 0 : AVGINSTBYTES;
+    case Instruction::Call:
+    case Instruction::Invoke: {
+      // The call and moving the arguments in place
+      ImmutableCallSite CS(I);
+      return CALLBYTES + AVGINSTBYTES * CS.arg_size();
+    }
+    case Instruction::Switch: {
+      // A compare and branch per case, or a jump table in the data
+      const SwitchInst *SI = cast<SwitchInst>(I);
+      return AVGINSTBYTES * (2 * (SI->getNumCases() - 1) + 1);
+    }
+    default:
+      return AVGINSTBYTES;
+  }
+}
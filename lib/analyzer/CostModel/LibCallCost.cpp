@@ -0,0 +1,161 @@
+/**
+ *  @file          LibCallCost.cpp
+ *
+ *  @version       1.0
+ *  @created       03/07/2013 03:15:22 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  LibCallCostDB implementation
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "llvm/Function.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Support/ConstantRange.h"
+
+#include "commons/handy.h"
+#include "analyzer/LibCallCost.h"
+
+using namespace llvm;
+
+bool LibCallCostDB::load(const char *fname)
+{
+  FILE *fp = fopen(fname, "r");
+  if (fp == NULL) {
+    perror("Read libcall cost database");
+    return false;
+  }
+  char buf[256];
+  unsigned line = 0;
+  while (fgetline(fp, buf, 256) != NULL) {
+    line++;
+    if (isempty(buf) || buf[0] == '#')
+      continue;
+    char name[128], sizearg[16], scale[16];
+    LibCallCostEntry entry;
+    if (sscanf(buf, "%127s %u %lf %15s %15s", name, &entry.base, &entry.factor,
+          sizearg, scale) != 5) {
+      syntaxerr("expected NAME BASE FACTOR SIZEARG SCALE", line);
+      fclose(fp);
+      return false;
+    }
+    // SIZEARG is either an index or COUNT*SIZE, e.g., 0*1 for calloc
+    int n = sscanf(sizearg, "%d*%d", &entry.countarg, &entry.sizearg);
+    if (n == 1) {
+      entry.sizearg = entry.countarg;
+      entry.countarg = -1;
+    }
+    else if (n != 2 || entry.countarg < 0 || entry.sizearg < 0) {
+      syntaxerr("expected SIZEARG as an index or COUNT*SIZE", line);
+      fclose(fp);
+      return false;
+    }
+    if (streq(scale, "const"))
+      entry.scale = ConstScale;
+    else if (streq(scale, "linear"))
+      entry.scale = LinearScale;
+    else if (streq(scale, "nlogn"))
+      entry.scale = NLogNScale;
+    else {
+      syntaxerr("unknown scale, expected const, linear or nlogn", line);
+      fclose(fp);
+      return false;
+    }
+    DB[name] = entry;
+  }
+  fclose(fp);
+  return true;
+}
+
+const LibCallCostEntry * LibCallCostDB::lookup(StringRef name) const
+{
+  const_iterator I = DB.find(name.str());
+  if (I == DB.end())
+    return NULL;
+  return &I->second;
+}
+
+const LibCallCostEntry * LibCallCostDB::lookup(const CallInst * CI) const
+{
+  if (const IntrinsicInst * II = dyn_cast<IntrinsicInst>(CI))
+    return lookup(Intrinsic::getName(II->getIntrinsicID()));
+  const Function * F = CI->getCalledFunction();
+  if (F == NULL)
+    return NULL;
+  return lookup(F->getName());
+}
+
+uint64_t LibCallCostDB::getArgSize(const CallInst * CI, int arg, 
+    ScalarEvolution * SE) const
+{
+  if (arg < 0 || (unsigned) arg >= CI->getNumArgOperands())
+    return 0;
+  Value * size = CI->getArgOperand(arg);
+  if (ConstantInt * C = dyn_cast<ConstantInt>(size))
+    return C->getLimitedValue(LIBCALL_MAX_SIZE);
+  // The bound of a range only says something about the size when it is
+  // small, e.g., a masked length; the bounds of a zext or a multiple of
+  // an unknown value are far above any realistic size
+  if (SE && SE->isSCEVable(size->getType())) {
+    ConstantRange range = SE->getUnsignedRange(SE->getSCEV(size));
+    if (!range.isFullSet() && range.getUnsignedMax().ule(LIBCALL_RANGE_SIZE))
+      return range.getUnsignedMax().getZExtValue();
+  }
+  return 0;
+}
+
+uint64_t LibCallCostDB::getCallSize(const CallInst * CI, 
+    const LibCallCostEntry * entry, ScalarEvolution * SE) const
+{
+  uint64_t size = getArgSize(CI, entry->sizearg, SE);
+  if (size == 0 || entry->countarg < 0)
+    return size;
+  uint64_t count = getArgSize(CI, entry->countarg, SE);
+  if (count == 0)
+    return 0;
+  if (count >= LIBCALL_MAX_SIZE / size)
+    return LIBCALL_MAX_SIZE;
+  return count * size;
+}
+
+unsigned LibCallCostDB::getCallCost(const CallInst * CI, ScalarEvolution * SE) const
+{
+  const LibCallCostEntry * entry = lookup(CI);
+  if (entry == NULL)
+    return -1;
+  if (entry->scale == ConstScale)
+    return entry->base;
+  uint64_t n = getCallSize(CI, entry, SE);
+  if (n == 0)
+    n = LIBCALL_DEFAULT_SIZE;
+  double units = n;
+  if (entry->scale == NLogNScale && n > 1)
+    units = n * log2((double) n);
+  double cost = entry->base + entry->factor * units;
+  if (cost > UINT_MAX / 2)
+    return UINT_MAX / 2;
+  return (unsigned) (cost + 0.5);
+}
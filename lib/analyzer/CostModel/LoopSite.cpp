@@ -0,0 +1,78 @@
+/**
+ *  @file          LoopSite.cpp
+ *
+ *  @version       1.0
+ *  @created       03/10/2013 11:05:21 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  LoopSite implementation
+ *
+ */
+
+#include "analyzer/LoopSite.h"
+
+using namespace llvm;
+
+static unsigned getHeaderLine(const BasicBlock * BB)
+{
+  for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+    DebugLoc Loc = I->getDebugLoc();
+    if (!Loc.isUnknown())
+      return Loc.getLine();
+  }
+  return 0;
+}
+
+static void collectNestedLoops(Loop * L, std::vector<Loop *> & Loops)
+{
+  Loops.push_back(L);
+  for (Loop::iterator I = L->begin(), E = L->end(); I != E; ++I)
+    collectNestedLoops(*I, Loops);
+}
+
+void LoopSite::setLoop(const Loop * L)
+{
+  Header = L->getHeader();
+  Line = getHeaderLine(Header);
+  Depth = L->getLoopDepth();
+}
+
+void llvm::collectLoops(LoopInfo & LI, std::vector<Loop *> & Loops)
+{
+  for (LoopInfo::iterator I = LI.begin(), E = LI.end(); I != E; ++I)
+    collectNestedLoops(*I, Loops);
+}
+
+unsigned llvm::getMaxTripCount(Loop * L, ScalarEvolution & SE)
+{
+  SmallVector<BasicBlock *, 4> exits;
+  L->getExitingBlocks(exits);
+  unsigned count = 0;
+  for (SmallVector<BasicBlock *, 4>::iterator ei = exits.begin(), ee = exits.end();
+      ei != ee; ++ei) {
+    if (*ei) {
+      unsigned c = SE.getSmallConstantTripCount(L, *ei);
+      if (c > count)
+        count = c;
+    }
+  }
+  return count;
+}
@@ -0,0 +1,176 @@
+/**
+ *  @file          MemoryCost.cpp
+ *
+ *  @version       1.0
+ *  @created       03/05/2013 11:02:18 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  MemoryCostAnalysis implementation
+ *
+ */
+
+#include <math.h>
+
+#include "llvm/Operator.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+
+#include "analyzer/MemoryCost.h"
+
+using namespace llvm;
+
+namespace llvm {
+
+static const char * AccessPatternStr[ACCESSPATTERNS] = {
+  "not in loop",
+  "invariant",
+  "unit-stride",
+  "large-stride",
+  "non-affine",
+  "indirect"
+};
+
+const char * toAccessPatternStr(AccessPattern pattern)
+{
+  if (pattern < 0 || pattern >= ACCESSPATTERNS)
+    return "UNKNOWN";
+  return AccessPatternStr[pattern];
+}
+
+} // End of llvm namespace
+
+static const Value * getPointerOperand(const Instruction * I)
+{
+  if (const LoadInst * LI = dyn_cast<LoadInst>(I))
+    return LI->getPointerOperand();
+  if (const StoreInst * SI = dyn_cast<StoreInst>(I))
+    return SI->getPointerOperand();
+  return NULL;
+}
+
+uint64_t MemoryCostAnalysis::getAccessSize(const Instruction * I) const
+{
+  Type * Ty;
+  if (const StoreInst * SI = dyn_cast<StoreInst>(I))
+    Ty = SI->getValueOperand()->getType();
+  else
+    Ty = I->getType();
+  if (!SE->isSCEVable(Ty))
+    return 0;
+  return SE->getTypeSizeInBits(Ty) / 8;
+}
+
+bool MemoryCostAnalysis::isIndirect(const Value * Ptr, const Loop * L) const
+{
+  // Walk the address computation (GEPs and casts) looking for a value
+  // that is loaded inside the loop: p->next or a[b[i]].
+  SmallVector<const Value *, 8> worklist;
+  SmallPtrSet<const Value *, 8> visited;
+  worklist.push_back(Ptr);
+  while (!worklist.empty()) {
+    const Value * V = worklist.pop_back_val();
+    if (!visited.insert(V))
+      continue;
+    const Instruction * I = dyn_cast<Instruction>(V);
+    if (I == NULL || !L->contains(I->getParent()))
+      continue;
+    if (isa<LoadInst>(I))
+      return true;
+    if (isa<GetElementPtrInst>(I) || isa<CastInst>(I) || isa<PHINode>(I) ||
+        isa<BinaryOperator>(I)) {
+      for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end(); 
+          OI != OE; ++OI)
+        worklist.push_back(*OI);
+    }
+  }
+  return false;
+}
+
+AccessPattern MemoryCostAnalysis::classify(const Instruction * I, int64_t & Stride) const
+{
+  Stride = 0;
+  const Value * Ptr = getPointerOperand(I);
+  assert(Ptr && "Not a memory access");
+  Loop * L = LI->getLoopFor(I->getParent());
+  if (L == NULL)
+    return NotInLoop;
+  Value * P = const_cast<Value *>(Ptr);
+  if (!SE->isSCEVable(P->getType()))
+    return isIndirect(Ptr, L) ? IndirectAccess : NonAffineAccess;
+  const SCEV * S = SE->getSCEV(P);
+  if (SE->isLoopInvariant(S, L))
+    return InvariantAccess;
+  if (const SCEVAddRecExpr * AR = dyn_cast<SCEVAddRecExpr>(S)) {
+    if (AR->getLoop() == L && AR->isAffine()) {
+      const SCEV * Step = AR->getStepRecurrence(*SE);
+      if (const SCEVConstant * C = dyn_cast<SCEVConstant>(Step)) {
+        Stride = C->getValue()->getSExtValue();
+        uint64_t abs = Stride < 0 ? -Stride : Stride;
+        if (abs <= getAccessSize(I))
+          return UnitStrideAccess;
+      }
+      return LargeStrideAccess;
+    }
+  }
+  if (isIndirect(Ptr, L))
+    return IndirectAccess;
+  return NonAffineAccess;
+}
+
+double MemoryCostAnalysis::getCacheLinesPerIteration(const Instruction * I) const
+{
+  int64_t Stride;
+  AccessPattern pattern = classify(I, Stride);
+  switch (pattern) {
+    case NotInLoop:
+    case InvariantAccess:
+      // Stays in the cache after the first access
+      return 0;
+    case UnitStrideAccess:
+    {
+      uint64_t size = getAccessSize(I);
+      if (size == 0)
+        size = 1;
+      return (double) size / LineSize;
+    }
+    case LargeStrideAccess:
+    {
+      // Unknown stride is assumed to touch a new line every iteration
+      if (Stride == 0)
+        return 1;
+      uint64_t abs = Stride < 0 ? -Stride : Stride;
+      if (abs >= LineSize)
+        return 1;
+      return (double) abs / LineSize;
+    }
+    case NonAffineAccess:
+    case IndirectAccess:
+    default:
+      return 1;
+  }
+}
+
+unsigned MemoryCostAnalysis::getMemoryTrafficCost(const Instruction * I) const
+{
+  return (unsigned) floor(getCacheLinesPerIteration(I) * CACHELINECOST + 0.5);
+}
@@ -0,0 +1,232 @@
+/**
+ *  @file          RegisterPressure.cpp
+ *
+ *  @version       1.0
+ *  @created       03/09/2013 04:15:02 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Register pressure of loops.
+ *
+ */
+
+#include "llvm/Support/CFG.h"
+#include "llvm/ADT/PostOrderIterator.h"
+
+#include "analyzer/RegisterPressure.h"
+
+using namespace llvm;
+
+RegisterPressureAnalysis::RegisterPressureAnalysis(const CostModel * CM)
+{
+  assert(CM && "Require a cost model");
+  NumScalarRegs = CM->getNumberOfRegisters(false);
+  if (NumScalarRegs > RESERVEDREGS)
+    NumScalarRegs -= RESERVEDREGS;
+  NumVectorRegs = CM->getNumberOfRegisters(true);
+  ScalarWidth = CM->getRegisterBitWidth(false);
+  VectorWidth = CM->getRegisterBitWidth(true);
+}
+
+bool RegisterPressureAnalysis::isTracked(const Value * V) const
+{
+  if (isa<Argument>(V))
+    return true;
+  const Instruction * I = dyn_cast<Instruction>(V);
+  if (I == NULL || I->getType()->isVoidTy())
+    return false;
+  // Static stack slots are addressed off the frame pointer
+  if (isa<AllocaInst>(I))
+    return false;
+  // A comparison feeding a single branch or select lives in the flags
+  if (isa<CmpInst>(I) && I->hasOneUse()) {
+    const User * U = *I->use_begin();
+    if (isa<BranchInst>(U) || isa<SelectInst>(U))
+      return false;
+  }
+  return true;
+}
+
+unsigned RegisterPressureAnalysis::getRegUnits(Type * Ty, bool & Vector) const
+{
+  // Floating point scalars live in the vector registers, e.g., SSE on x86
+  Vector = (Ty->isVectorTy() || Ty->isFloatingPointTy()) && NumVectorRegs;
+  unsigned Width = Vector ? VectorWidth : ScalarWidth;
+  unsigned Bits = Ty->getPrimitiveSizeInBits();
+  // Pointers and aggregates are counted as a single register
+  if (Bits == 0 || Width == 0)
+    return 1;
+  return (Bits + Width - 1) / Width;
+}
+
+void RegisterPressureAnalysis::count(const ValueSet & Live, unsigned & Scalar, 
+    unsigned & Vector) const
+{
+  Scalar = Vector = 0;
+  bool IsVector;
+  for (ValueSet::const_iterator I = Live.begin(), E = Live.end(); I != E; ++I) {
+    unsigned Units = getRegUnits((*I)->getType(), IsVector);
+    if (IsVector)
+      Vector += Units;
+    else
+      Scalar += Units;
+  }
+}
+
+void RegisterPressureAnalysis::computeLiveness(Function & F, LiveMapTy & LiveOut) const
+{
+  LiveMapTy LiveIn;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    // Visit the blocks in post order so that most successors are
+    // visited before their predecessors
+    for (po_iterator<BasicBlock *> BI = po_begin(&F.getEntryBlock()), 
+        BE = po_end(&F.getEntryBlock()); BI != BE; ++BI) {
+      BasicBlock * BB = *BI;
+      ValueSet Out;
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI) {
+        BasicBlock * Succ = *SI;
+        const ValueSet & In = LiveIn[Succ];
+        for (ValueSet::const_iterator VI = In.begin(), VE = In.end(); VI != VE; ++VI) {
+          // PHIs of the successor are defined on the edge
+          const PHINode * PN = dyn_cast<PHINode>(*VI);
+          if (PN == NULL || PN->getParent() != Succ)
+            Out.insert(*VI);
+        }
+        for (BasicBlock::iterator I = Succ->begin(); isa<PHINode>(I); ++I) {
+          Value * V = cast<PHINode>(I)->getIncomingValueForBlock(BB);
+          if (isTracked(V))
+            Out.insert(V);
+        }
+      }
+      ValueSet In = Out;
+      for (BasicBlock::reverse_iterator I = BB->rbegin(), E = BB->rend(); I != E; ++I) {
+        In.erase(&*I);
+        if (isa<PHINode>(*I)) {
+          if (isTracked(&*I))
+            In.insert(&*I);
+          continue;
+        }
+        for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE; ++OI)
+          if (isTracked(*OI))
+            In.insert(*OI);
+      }
+      LiveOut[BB].swap(Out);
+      ValueSet & OldIn = LiveIn[BB];
+      if (OldIn != In) {
+        OldIn.swap(In);
+        Changed = true;
+      }
+    }
+  }
+}
+
+void RegisterPressureAnalysis::computeBlockPressure(const BasicBlock * BB, 
+    const ValueSet & LiveOut, unsigned & Scalar, unsigned & Vector) const
+{
+  ValueSet Live = LiveOut;
+  count(Live, Scalar, Vector);
+  unsigned S, V;
+  for (BasicBlock::const_reverse_iterator I = BB->rbegin(), E = BB->rend(); I != E; ++I) {
+    if (isa<PHINode>(*I))
+      break;
+    // The result is live right after the instruction
+    if (isTracked(&*I))
+      Live.insert(&*I);
+    count(Live, S, V);
+    if (S > Scalar)
+      Scalar = S;
+    if (V > Vector)
+      Vector = V;
+    Live.erase(&*I);
+    for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE; ++OI)
+      if (isTracked(*OI))
+        Live.insert(*OI);
+  }
+  // The PHIs are all live at the block entry
+  for (BasicBlock::const_iterator I = BB->begin(); isa<PHINode>(I); ++I)
+    if (isTracked(&*I))
+      Live.insert(&*I);
+  count(Live, S, V);
+  if (S > Scalar)
+    Scalar = S;
+  if (V > Vector)
+    Vector = V;
+}
+
+void RegisterPressureAnalysis::analyze(Function & F, LoopInfo & LI, 
+    std::vector<LoopPressure> & Result) const
+{
+  Result.clear();
+  if (F.isDeclaration() || LI.empty())
+    return;
+  LiveMapTy LiveOut;
+  computeLiveness(F, LiveOut);
+  BlockPressureTy BlockPressure;
+  for (LiveMapTy::iterator I = LiveOut.begin(), E = LiveOut.end(); I != E; ++I) {
+    std::pair<unsigned, unsigned> & P = BlockPressure[I->first];
+    computeBlockPressure(I->first, I->second, P.first, P.second);
+  }
+
+  std::vector<Loop *> Loops;
+  collectLoops(LI, Loops);
+  for (std::vector<Loop *>::iterator I = Loops.begin(), E = Loops.end(); I != E; ++I) {
+    Loop * L = *I;
+    LoopPressure P;
+    P.setLoop(L);
+    for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end(); BI != BE; ++BI) {
+      BlockPressureTy::iterator BPI = BlockPressure.find(*BI);
+      if (BPI == BlockPressure.end())
+        continue;
+      if (BPI->second.first > P.Scalar)
+        P.Scalar = BPI->second.first;
+      if (BPI->second.second > P.Vector)
+        P.Vector = BPI->second.second;
+    }
+    Result.push_back(P);
+  }
+}
+
+const LoopPressure * RegisterPressureAnalysis::match(const LoopPressure & After, 
+    unsigned Idx, const std::vector<LoopPressure> & Before) const
+{
+  return matchLoopSite(After, Idx, Before);
+}
+
+unsigned RegisterPressureAnalysis::getSpills(const LoopPressure & P) const
+{
+  unsigned spills = 0;
+  if (P.Scalar > NumScalarRegs)
+    spills += P.Scalar - NumScalarRegs;
+  if (P.Vector > NumVectorRegs)
+    spills += P.Vector - NumVectorRegs;
+  return spills;
+}
+
+bool LoopPressurePass::runOnFunction(Function &F)
+{
+  LoopInfo *LI = &getAnalysis<LoopInfo>(); 
+  RPA->analyze(F, *LI, Result);
+  return false;
+}
+
+char LoopPressurePass::ID = 0;
+const char * LoopPressurePass::PassName = "Loop register pressure";
@@ -0,0 +1,317 @@
+/**
+ *  @file          Vectorizability.cpp
+ *
+ *  @version       1.0
+ *  @created       03/20/2013 11:06:30 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Vectorization legality of loops.
+ *
+ */
+
+#include "llvm/IntrinsicInst.h"
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+
+#include "analyzer/Vectorizability.h"
+
+using namespace llvm;
+
+namespace llvm {
+
+static const char * VectorBlockerStr[VECTORBLOCKERS] = {
+  "vectorizable",
+  "not innermost",
+  "complex control flow",
+  "unknown trip count",
+  "call in loop",
+  "loop-carried value",
+  "memory dependence",
+  "may-alias store",
+  "unsupported memory access",
+  "unsupported type",
+  "no vector unit"
+};
+
+const char * toVectorBlockerStr(VectorBlocker blocker)
+{
+  if (blocker < 0 || blocker >= VECTORBLOCKERS)
+    return "UNKNOWN";
+  return VectorBlockerStr[blocker];
+}
+
+} // End of llvm namespace
+
+static Value * getPointerOperand(Instruction * I)
+{
+  if (LoadInst * LI = dyn_cast<LoadInst>(I))
+    return LI->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+static Type * getAccessType(Instruction * I)
+{
+  if (StoreInst * SI = dyn_cast<StoreInst>(I))
+    return SI->getValueOperand()->getType();
+  return I->getType();
+}
+
+// Math intrinsics with a vector counterpart
+static bool isVectorizableIntrinsic(const IntrinsicInst * II)
+{
+  switch (II->getIntrinsicID()) {
+    case Intrinsic::sqrt:
+    case Intrinsic::sin:
+    case Intrinsic::cos:
+    case Intrinsic::exp:
+    case Intrinsic::exp2:
+    case Intrinsic::log:
+    case Intrinsic::log2:
+    case Intrinsic::log10:
+    case Intrinsic::pow:
+    case Intrinsic::fma:
+      return true;
+    default:
+      return false;
+  }
+}
+
+VectorizationLegality::VectorizationLegality(const CostModel * CM)
+{
+  assert(CM && "Require a cost model");
+  // Without vector registers there is nothing to vectorize for
+  VectorWidth = CM->getNumberOfRegisters(true) ? CM->getRegisterBitWidth(true) : 0;
+}
+
+void VectorizationLegality::analyze(Function & F, LoopInfo & LI, 
+    ScalarEvolution & SE, DominatorTree & DT, 
+    std::vector<LoopVectorization> & Result) const
+{
+  std::vector<Loop *> Loops;
+  collectLoops(LI, Loops);
+  for (std::vector<Loop *>::iterator I = Loops.begin(), E = Loops.end(); 
+      I != E; ++I) {
+    LoopVectorization LV;
+    LV.setLoop(*I);
+    LV.Blocker = check(*I, SE, DT, LV.Culprit, LV.Width);
+    Result.push_back(LV);
+  }
+}
+
+bool VectorizationLegality::isInductionOrReduction(PHINode * PN, Loop * L, 
+    ScalarEvolution & SE) const
+{
+  BasicBlock * Latch = L->getLoopLatch();
+  if (PN->getNumIncomingValues() != 2 || PN->getBasicBlockIndex(Latch) < 0)
+    return false;
+  if (SE.isSCEVable(PN->getType())) {
+    const SCEVAddRecExpr * AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(PN));
+    if (AR && AR->getLoop() == L && AR->isAffine())
+      return true;
+  }
+  // A reduction updates the phi with a chain of the same associative
+  // operation, e.g., sum = sum + a[i]
+  BinaryOperator * BO = dyn_cast<BinaryOperator>(PN->getIncomingValueForBlock(Latch));
+  if (BO == NULL)
+    return false;
+  unsigned Opcode = BO->getOpcode();
+  switch (Opcode) {
+    case Instruction::Add:
+    case Instruction::Mul:
+    case Instruction::And:
+    case Instruction::Or:
+    case Instruction::Xor:
+    case Instruction::FAdd:
+    case Instruction::FMul:
+      break;
+    default:
+      return false;
+  }
+  for (unsigned steps = 0; steps < MAXREDUCTIONCHAIN; ++steps) {
+    if (BO->getOperand(0) == PN || BO->getOperand(1) == PN)
+      return true;
+    BinaryOperator * Next = NULL;
+    for (unsigned i = 0; i < 2 && Next == NULL; ++i) {
+      BinaryOperator * Op = dyn_cast<BinaryOperator>(BO->getOperand(i));
+      if (Op && Op->getOpcode() == Opcode && L->contains(Op->getParent()))
+        Next = Op;
+    }
+    if (Next == NULL)
+      return false;
+    BO = Next;
+  }
+  return false;
+}
+
+VectorBlocker VectorizationLegality::check(Loop * L, ScalarEvolution & SE, 
+    DominatorTree & DT, const Instruction *& Culprit, unsigned & Width) const
+{
+  Culprit = NULL;
+  Width = 0;
+  if (!L->empty())
+    return NotInnermostLoop;
+  if (VectorWidth == 0)
+    return NoVectorUnit;
+  BasicBlock * Latch = L->getLoopLatch();
+  if (L->getLoopPreheader() == NULL || Latch == NULL || L->getExitingBlock() != Latch)
+    return ComplexControlFlow;
+  if (isa<SCEVCouldNotCompute>(SE.getBackedgeTakenCount(L)))
+    return UnknownTripCount;
+
+  SmallVector<Instruction *, 16> Accesses;
+  unsigned MaxBits = 0;
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end(); 
+      BI != BE; ++BI) {
+    BasicBlock * BB = *BI;
+    // Blocks not run in every iteration need if-conversion, which
+    // needs masked loads and stores
+    bool Conditional = !DT.dominates(BB, Latch);
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      Culprit = I;
+      if (PHINode * PN = dyn_cast<PHINode>(I)) {
+        if (BB == L->getHeader() && !isInductionOrReduction(PN, L, SE))
+          return LoopCarriedValue;
+        continue;
+      }
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (IntrinsicInst * II = dyn_cast<IntrinsicInst>(I)) {
+        if (II->getIntrinsicID() == Intrinsic::lifetime_start ||
+            II->getIntrinsicID() == Intrinsic::lifetime_end ||
+            isVectorizableIntrinsic(II))
+          continue;
+      }
+      if (isa<CallInst>(I) || isa<InvokeInst>(I))
+        return CallInLoop;
+      if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I) || isa<FenceInst>(I))
+        return UnsupportedAccess;
+      if (I->getType()->isAggregateType() || I->getType()->isVectorTy())
+        return UnsupportedType;
+      if (isa<LoadInst>(I) || isa<StoreInst>(I)) {
+        LoadInst * LI = dyn_cast<LoadInst>(I);
+        StoreInst * SI = dyn_cast<StoreInst>(I);
+        if ((LI && (LI->isVolatile() || LI->isAtomic())) || 
+            (SI && (SI->isVolatile() || SI->isAtomic())))
+          return UnsupportedAccess;
+        if (Conditional)
+          return ComplexControlFlow;
+        Type * Ty = getAccessType(I);
+        if (Ty->isAggregateType() || Ty->isVectorTy())
+          return UnsupportedType;
+        unsigned Bits = SE.isSCEVable(Ty) ? (unsigned) SE.getTypeSizeInBits(Ty) : 
+          Ty->getPrimitiveSizeInBits();
+        if (Bits > MaxBits)
+          MaxBits = Bits;
+        Accesses.push_back(I);
+      }
+    }
+  }
+  Culprit = NULL;
+  if (MaxBits == 0)
+    MaxBits = 32;
+  Width = VectorWidth / MaxBits;
+  if (Width < 2) {
+    Width = 0;
+    return NoVectorUnit;
+  }
+  VectorBlocker Blocker = checkMemory(L, Accesses, SE, Width, Culprit);
+  if (Blocker != VectorizableLoop)
+    Width = 0;
+  return Blocker;
+}
+
+VectorBlocker VectorizationLegality::checkMemory(Loop * L, 
+    SmallVectorImpl<Instruction *> & Accesses, ScalarEvolution & SE, 
+    unsigned Width, const Instruction *& Culprit) const
+{
+  for (SmallVectorImpl<Instruction *>::iterator SI = Accesses.begin(), 
+      SIE = Accesses.end(); SI != SIE; ++SI) {
+    if (!isa<StoreInst>(*SI))
+      continue;
+    Culprit = *SI;
+    Value * Ptr = getPointerOperand(*SI);
+    int64_t Size = SE.getTypeSizeInBits(getAccessType(*SI)) / 8;
+    // Only consecutive stores can be widened, there is no scatter
+    const SCEVAddRecExpr * AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Ptr));
+    if (AR == NULL || AR->getLoop() != L || !AR->isAffine())
+      return UnsupportedAccess;
+    const SCEVConstant * Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+    if (Step == NULL)
+      return UnsupportedAccess;
+    int64_t Stride = Step->getValue()->getSExtValue();
+    if (Stride != Size && Stride != -Size)
+      return UnsupportedAccess;
+
+    Value * Obj = GetUnderlyingObject(Ptr);
+    for (SmallVectorImpl<Instruction *>::iterator AI = Accesses.begin(), 
+        AE = Accesses.end(); AI != AE; ++AI) {
+      if (AI == SI)
+        continue;
+      Value * OtherPtr = getPointerOperand(*AI);
+      Value * OtherObj = GetUnderlyingObject(OtherPtr);
+      if (Obj != OtherObj) {
+        // Distinct allocations, globals or noalias arguments
+        if (isIdentifiedObject(Obj) && isIdentifiedObject(OtherObj))
+          continue;
+        return MayAliasStore;
+      }
+      const SCEVConstant * Dist = dyn_cast<SCEVConstant>(
+          SE.getMinusSCEV(SE.getSCEV(OtherPtr), SE.getSCEV(Ptr)));
+      if (Dist == NULL) {
+        Culprit = *AI;
+        return MemoryDependence;
+      }
+      int64_t D = Dist->getValue()->getSExtValue();
+      if (D == 0)
+        continue;
+      // The other access touches what the store wrote in an earlier
+      // iteration, e.g., a[i] = a[i-1], or writes the same memory
+      bool Backward = (D < 0) == (Stride > 0);
+      uint64_t AbsD = D < 0 ? -D : D;
+      if ((Backward || isa<StoreInst>(*AI)) && AbsD < Width * (uint64_t) Size) {
+        Culprit = *AI;
+        return MemoryDependence;
+      }
+    }
+  }
+  Culprit = NULL;
+  return VectorizableLoop;
+}
+
+const LoopVectorization * VectorizationLegality::match(const LoopVectorization & After, 
+    unsigned Idx, const std::vector<LoopVectorization> & Before) const
+{
+  return matchLoopSite(After, Idx, Before);
+}
+
+bool LoopVectorizationPass::runOnFunction(Function &F)
+{
+  LoopInfo *LI = &getAnalysis<LoopInfo>(); 
+  ScalarEvolution *SE = &getAnalysis<ScalarEvolution>(); 
+  DominatorTree *DT = &getAnalysis<DominatorTree>(); 
+  VL->analyze(F, *LI, *SE, *DT, Result);
+  return false;
+}
+
+char LoopVectorizationPass::ID = 0;
+const char * LoopVectorizationPass::PassName = "Loop vectorization legality";
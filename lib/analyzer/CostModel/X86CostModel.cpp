@@ -67,6 +67,7 @@ X86CostModel::X86CostModel(TargetMachine *TM)
   assert (TM && "Target machine cannot be NULL");
   TLI = TM->getTargetLowering();
   assert(TLI && "No associated target lowering");
+  CCT = NULL;
   VTT = new VectorTargetTransformStub(TLI);
 
   const MCSubtargetInfo &TSI = TM->getSubtarget<MCSubtargetInfo>();
@@ -94,6 +95,19 @@ X86CostModel::~X86CostModel()
     delete VTT;
   if (ST == NULL)
     delete ST;
+  delete CCT;
+}
+
+bool X86CostModel::loadCostTable(const char *fname)
+{
+  CalibratedCostTable * table = new CalibratedCostTable();
+  if (!table->load(fname)) {
+    delete table;
+    return false;
+  }
+  delete CCT;
+  CCT = table;
+  return true;
 }
 
 unsigned X86CostModel::getNumberOfRegisters(bool Vector) const
@@ -138,6 +152,12 @@ unsigned X86CostModel::getArithmeticInstrCost(unsigned Opcode, Type *Ty) const
   int ISD = VectorTargetTransformStub::InstructionOpcodeToISD(Opcode);
   assert(ISD && "Invalid opcode");
 
+  if (CCT) {
+    int Cost = CCT->lookup(Opcode, LT.second);
+    if (Cost != -1)
+      return LT.first * Cost;
+  }
+
   static const CostTblEntry<MVT> AVX1CostTable[] = {
     // We don't have to scalarize unsupported ops. We can issue two half-sized
     // operations and we only need to extract the upper YMM half.
@@ -194,6 +214,12 @@ unsigned X86CostModel::getCastInstrCost(unsigned Opcode, Type *Dst,
     return VTT->getCastInstrCost(Opcode, Dst, Src);
   }
 
+  if (CCT) {
+    int Cost = CCT->lookup(Opcode, DstTy.getSimpleVT(), SrcTy.getSimpleVT());
+    if (Cost != -1)
+      return Cost;
+  }
+
   static const TypeConversionCostTblEntry<MVT> AVXConversionTbl[] = {
     { ISD::SIGN_EXTEND, MVT::v8i32, MVT::v8i16, 1 },
     { ISD::ZERO_EXTEND, MVT::v8i32, MVT::v8i16, 1 },
@@ -234,6 +260,12 @@ unsigned X86CostModel::getCmpSelInstrCost(unsigned Opcode, Type *ValTy,
   int ISD = VectorTargetTransformStub::InstructionOpcodeToISD(Opcode);
   assert(ISD && "Invalid opcode");
 
+  if (CCT) {
+    int Cost = CCT->lookup(Opcode, MTy);
+    if (Cost != -1)
+      return LT.first * Cost;
+  }
+
   static const CostTblEntry<MVT> SSE42CostTbl[] = {
     { ISD::SETCC,   MVT::v2f64,   1 },
     { ISD::SETCC,   MVT::v4f32,   1 },
@@ -316,6 +348,12 @@ unsigned X86CostModel::getMemoryOpCost(unsigned Opcode, Type *Src,
   assert((Opcode == Instruction::Load || Opcode == Instruction::Store) &&
          "Invalid Opcode");
 
+  if (CCT) {
+    int Cost = CCT->lookup(Opcode, LT.second);
+    if (Cost != -1)
+      return LT.first * Cost;
+  }
+
   // Each load/store unit costs 1.
   unsigned Cost = LT.first * 1;
 
@@ -329,3 +367,26 @@ unsigned X86CostModel::getMemoryOpCost(unsigned Opcode, Type *Src,
 }
 
 
+
+unsigned X86CostModel::getAtomicInstrCost(unsigned Opcode, Type *Ty,
+   AtomicOrdering Ordering) const
+{
+  switch (Opcode) {
+    case Instruction::Fence:
+      // x86-TSO only needs an mfence for sequential consistency; the weaker
+      // fences just constrain the compiler.
+      if (Ordering == SequentiallyConsistent)
+        return LOCKED_INST_COST;
+      return TCC_Free;
+    case Instruction::Load:
+      // Plain loads already have acquire semantics
+      return TCC_Free;
+    case Instruction::Store:
+      // A sequentially consistent store is lowered to xchg
+      if (Ordering == SequentiallyConsistent)
+        return LOCKED_INST_COST;
+      return TCC_Free;
+    default:
+      return CostModel::getAtomicInstrCost(Opcode, Ty, Ordering);
+  }
+}
@@ -118,3 +118,33 @@ void DiffConsumer::logf(const LogBuilder &Log) {
 
 void DiffConsumer::logd(const DiffLogBuilder &Log) {
 }
+
+SummaryConsumer::SummaryConsumer(unsigned Reserve, bool StopEarly)
+  : Current(-1), Differences(false), StopEarly(StopEarly) {
+  counts.reserve(Reserve);
+}
+
+void SummaryConsumer::enterContext(Value *L, Value *R) {
+  contexts.push_back(std::make_pair(L, R));
+  if (isa<Function>(L)) {
+    counts.push_back(FunctionDiffCount(cast<Function>(L), cast<Function>(R)));
+    Current = counts.size() - 1;
+  }
+}
+
+void SummaryConsumer::exitContext() {
+  if (isa<Function>(contexts.back().first))
+    Current = -1;
+  contexts.pop_back();
+}
+
+void SummaryConsumer::setDiff(bool diff) {
+  Differences = diff;
+  if (!diff || Current < 0)
+    return;
+  FunctionDiffCount &Count = counts[Current];
+  if (Count.Differences++ == 0) {
+    Count.FirstL = contexts.back().first;
+    Count.FirstR = contexts.back().second;
+  }
+}
@@ -12,6 +12,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <map>
+#include <set>
 #include <utility>
 
 #include "llvm/Constants.h"
@@ -22,7 +24,6 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
-#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/CFG.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -30,6 +31,8 @@
 #include "llvm/Support/type_traits.h"
 
 #include "analyzer/DifferenceEngine.h"
+#include "analyzer/FunctionHash.h"
+#include "analyzer/FunctionSimilarity.h"
 
 using namespace llvm;
 
@@ -185,7 +188,7 @@ class FunctionDifferenceEngine {
   }
 
   void processQueue() {
-    while (!Queue.empty()) {
+    while (!Queue.empty() && !Engine.shouldStop()) {
       BlockPair Pair = Queue.remove_min();
       diff(Pair.first, Pair.second);
     }
@@ -657,38 +660,212 @@ void DifferenceEngine::diff(Function *L, Function *R) {
     FunctionDifferenceEngine(*this).diff(L, R);
 }
 
+void DifferenceEngine::matchRenamed(SmallVectorImpl<Function*> &LOnly,
+                                    SmallVectorImpl<Function*> &ROnly,
+                                    FunctionPairs &Renamed) {
+  FunctionHasher Hasher;
+  // Hashes of the functions defined only in the right module; of the
+  // functions with the same hash, only the first can be paired by it.
+  std::map<uint64_t, Function*> RHashes;
+  for (SmallVectorImpl<Function*>::iterator I = ROnly.begin(), E = ROnly.end();
+       I != E; ++I) {
+    uint64_t H = Hasher.hash(*I);
+    if (!RHashes.count(H))
+      RHashes[H] = *I;
+  }
+
+  std::set<Function*> Paired;
+  SmallVector<Function*, 8> LLeft;
+  for (SmallVectorImpl<Function*>::iterator I = LOnly.begin(), E = LOnly.end();
+       I != E; ++I) {
+    std::map<uint64_t, Function*>::iterator RI = RHashes.find(Hasher.hash(*I));
+    if (RI != RHashes.end()) {
+      Renamed.push_back(std::make_pair(*I, RI->second));
+      Paired.insert(RI->second);
+      RHashes.erase(RI);
+    } else
+      LLeft.push_back(*I);
+  }
+
+  SimilarityIndex Index;
+  for (SmallVectorImpl<Function*>::iterator I = ROnly.begin(), E = ROnly.end();
+       I != E; ++I)
+    if (!Paired.count(*I))
+      Index.insert(*I);
+  LOnly.clear();
+  for (SmallVectorImpl<Function*>::iterator I = LLeft.begin(), E = LLeft.end();
+       I != E; ++I) {
+    if (Function *RFn = Index.findClosest(*I)) {
+      Renamed.push_back(std::make_pair(*I, RFn));
+      Paired.insert(RFn);
+    } else
+      LOnly.push_back(*I);
+  }
+
+  SmallVector<Function*, 8> RLeft;
+  for (SmallVectorImpl<Function*>::iterator I = ROnly.begin(), E = ROnly.end();
+       I != E; ++I)
+    if (!Paired.count(*I))
+      RLeft.push_back(*I);
+  ROnly.clear();
+  ROnly.append(RLeft.begin(), RLeft.end());
+
+  for (FunctionPairs::iterator I = Renamed.begin(), E = Renamed.end();
+       I != E; ++I)
+    renamed[I->first] = I->second;
+}
+
 void DifferenceEngine::diff(Module *L, Module *R) {
-  StringSet<> LNames;
   SmallVector<std::pair<Function*,Function*>, 20> Queue;
+  SmallVector<Function*, 8> LOnly, ROnly;
+  renamed.clear();
 
   for (Module::iterator I = L->begin(), E = L->end(); I != E; ++I) {
     Function *LFn = &*I;
-    LNames.insert(LFn->getName());
-
     if (Function *RFn = R->getFunction(LFn->getName()))
       Queue.push_back(std::make_pair(LFn, RFn));
-    else {
+    else if (LFn->isDeclaration()) {
         consumer.setDiff(true);
         return;
         //logf("function %l exists only in left module") << LFn;
       }
+    else
+      LOnly.push_back(LFn);
   }
 
   for (Module::iterator I = R->begin(), E = R->end(); I != E; ++I) {
     Function *RFn = &*I;
-    if (!LNames.count(RFn->getName())) {
+    if (L->getFunction(RFn->getName()))
+      continue;
+    if (RFn->isDeclaration()) {
         consumer.setDiff(true);
         return;
         //logf("function %r exists only in right module") << RFn;
     }
+    ROnly.push_back(RFn);
   }
 
+  // Renamed functions are diffed as a pair; the functions left
+  // unpaired exist only in one of the modules.
+  if (!LOnly.empty() || !ROnly.empty()) {
+    matchRenamed(LOnly, ROnly, Queue);
+    if (!LOnly.empty() || !ROnly.empty()) {
+      consumer.setDiff(true);
+      return;
+    }
+  }
+
+  FunctionHasher Hasher;
   for (SmallVectorImpl<std::pair<Function*,Function*> >::iterator
-         I = Queue.begin(), E = Queue.end(); I != E; ++I)
+         I = Queue.begin(), E = Queue.end(); I != E; ++I) {
+    // Skip the unification of structurally identical functions
+    if (!I->first->empty() && !I->second->empty() &&
+        Hasher.hash(I->first) == Hasher.hash(I->second))
+      continue;
     diff(I->first, I->second);
+    if (shouldStop())
+      return;
+  }
+}
+
+static const char *FunctionDiffStr[] = {
+  "identical",
+  "renamed",
+  "changed",
+  "added",
+  "removed"
+};
+
+const char *llvm::toFunctionDiffStr(FunctionDiffKind Kind) {
+  if (Kind < FunctionIdentical || Kind > FunctionRemoved)
+    return "UNKNOWN";
+  return FunctionDiffStr[Kind];
+}
+
+void DifferenceEngine::summarize(Module *L, Module *R,
+                                 std::vector<FunctionDiffResult> &Results) {
+  SmallVector<std::pair<Function*,Function*>, 20> Pairs;
+  SmallVector<std::pair<Function*,Function*>, 8> Renamed;
+  SmallVector<Function*, 8> LOnly, ROnly;
+  renamed.clear();
+
+  for (Module::iterator I = L->begin(), E = L->end(); I != E; ++I) {
+    Function *LFn = &*I;
+    Function *RFn = R->getFunction(LFn->getName());
+    // A body on one side only has nothing to be compared with, so the
+    // function is added or removed rather than changed
+    if (LFn->isDeclaration()) {
+      if (RFn && !RFn->isDeclaration())
+        Results.push_back(FunctionDiffResult(FunctionAdded, "",
+                                             RFn->getName()));
+      continue;
+    }
+    if (RFn != NULL && RFn->isDeclaration())
+      Results.push_back(FunctionDiffResult(FunctionRemoved, LFn->getName(),
+                                           ""));
+    else if (RFn == NULL)
+      LOnly.push_back(LFn);
+    else
+      Pairs.push_back(std::make_pair(LFn, RFn));
+  }
+
+  for (Module::iterator I = R->begin(), E = R->end(); I != E; ++I) {
+    Function *RFn = &*I;
+    if (!RFn->isDeclaration() && !L->getFunction(RFn->getName()))
+      ROnly.push_back(RFn);
+  }
+
+  // Pair the renamed functions first, so that calls to them are
+  // equivalent when their callers are diffed.
+  matchRenamed(LOnly, ROnly, Renamed);
+
+  FunctionHasher Hasher;
+  for (SmallVectorImpl<std::pair<Function*,Function*> >::iterator
+         I = Pairs.begin(), E = Pairs.end(); I != E; ++I) {
+    Function *LFn = I->first, *RFn = I->second;
+    if (Hasher.hash(LFn) == Hasher.hash(RFn)) {
+      Results.push_back(FunctionDiffResult(FunctionIdentical, LFn->getName(),
+                                           RFn->getName()));
+      continue;
+    }
+    // Unify the pair from a clean state
+    consumer.setDiff(false);
+    diff(LFn, RFn);
+    Results.push_back(FunctionDiffResult(consumer.hadDifferences() ?
+          FunctionChanged : FunctionIdentical, LFn->getName(), RFn->getName()));
+  }
+
+  for (SmallVectorImpl<std::pair<Function*,Function*> >::iterator
+         I = Renamed.begin(), E = Renamed.end(); I != E; ++I) {
+    Function *LFn = I->first, *RFn = I->second;
+    bool Changed = false;
+    if (Hasher.hash(LFn) != Hasher.hash(RFn)) {
+      consumer.setDiff(false);
+      diff(LFn, RFn);
+      Changed = consumer.hadDifferences();
+    }
+    Results.push_back(FunctionDiffResult(Changed ? FunctionChanged :
+          FunctionRenamed, LFn->getName(), RFn->getName()));
+  }
+
+  for (SmallVectorImpl<Function*>::iterator I = LOnly.begin(), E = LOnly.end();
+       I != E; ++I)
+    Results.push_back(FunctionDiffResult(FunctionRemoved, (*I)->getName(), ""));
+  for (SmallVectorImpl<Function*>::iterator I = ROnly.begin(), E = ROnly.end();
+       I != E; ++I)
+    Results.push_back(FunctionDiffResult(FunctionAdded, "", (*I)->getName()));
+
+  consumer.setDiff(false);
+  for (std::vector<FunctionDiffResult>::iterator I = Results.begin(),
+       E = Results.end(); I != E; ++I)
+    if (I->Kind != FunctionIdentical)
+      consumer.setDiff(true);
 }
 
 bool DifferenceEngine::equivalentAsOperands(GlobalValue *L, GlobalValue *R) {
   if (globalValueOracle) return (*globalValueOracle)(L, R);
-  return L->getName() == R->getName();
+  if (L->getName() == R->getName())
+    return true;
+  DenseMap<GlobalValue*, GlobalValue*>::iterator I = renamed.find(L);
+  return I != renamed.end() && I->second == R;
 }
@@ -0,0 +1,293 @@
+/**
+ *  @file          FunctionHash.cpp
+ *
+ *  @version       1.0
+ *  @created       03/11/2013 10:42:51 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Structural hash of a function.
+ *
+ */
+
+#include <ctype.h>
+
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/InlineAsm.h"
+#include "llvm/Metadata.h"
+
+#include "analyzer/FunctionHash.h"
+
+using namespace llvm;
+
+#define MAXTYPEDEPTH 3 // how deep to descend into nested types
+
+enum HashTag {
+  BlockTag = 0x9e3779b9,
+  MetadataTag
+};
+
+void FunctionHasher::add(uint64_t V)
+{
+  Hash ^= V + 0x9e3779b97f4a7c15ULL + (Hash << 6) + (Hash >> 2);
+}
+
+void FunctionHasher::add(StringRef S)
+{
+  // FNV-1a
+  uint64_t H = 0xcbf29ce484222325ULL;
+  for (StringRef::iterator I = S.begin(), E = S.end(); I != E; ++I) {
+    H ^= (unsigned char) *I;
+    H *= 0x100000001b3ULL;
+  }
+  add(H);
+}
+
+unsigned FunctionHasher::getNumber(const Value * V)
+{
+  DenseMap<const Value *, unsigned>::iterator I = Numbering.find(V);
+  if (I != Numbering.end())
+    return I->second;
+  unsigned N = Numbering.size();
+  Numbering[V] = N;
+  return N;
+}
+
+void FunctionHasher::addType(Type * Ty, unsigned Depth)
+{
+  add(Ty->getTypeID());
+  if (Depth > MAXTYPEDEPTH)
+    return;
+  switch (Ty->getTypeID()) {
+    case Type::IntegerTyID:
+      add(cast<IntegerType>(Ty)->getBitWidth());
+      break;
+    case Type::PointerTyID:
+      add(cast<PointerType>(Ty)->getAddressSpace());
+      addType(cast<PointerType>(Ty)->getElementType(), Depth + 1);
+      break;
+    case Type::ArrayTyID:
+      add(cast<ArrayType>(Ty)->getNumElements());
+      addType(cast<ArrayType>(Ty)->getElementType(), Depth + 1);
+      break;
+    case Type::VectorTyID:
+      add(cast<VectorType>(Ty)->getNumElements());
+      addType(cast<VectorType>(Ty)->getElementType(), Depth + 1);
+      break;
+    case Type::StructTyID: {
+      StructType * STy = cast<StructType>(Ty);
+      if (STy->hasName()) {
+        // Strip the suffix added when the same struct is loaded from
+        // another module into the context, e.g., struct.foo.1
+        StringRef Name = STy->getName();
+        size_t Dot = Name.rfind('.');
+        if (Dot != StringRef::npos && Dot + 1 < Name.size()) {
+          bool Digits = true;
+          for (size_t i = Dot + 1; i < Name.size() && Digits; ++i)
+            Digits = isdigit(Name[i]);
+          if (Digits)
+            Name = Name.substr(0, Dot);
+        }
+        add(Name);
+      }
+      add(STy->isPacked());
+      add(STy->getNumElements());
+      for (StructType::element_iterator I = STy->element_begin(), 
+          E = STy->element_end(); I != E; ++I)
+        addType(*I, Depth + 1);
+      break;
+    }
+    case Type::FunctionTyID: {
+      FunctionType * FTy = cast<FunctionType>(Ty);
+      add(FTy->isVarArg());
+      add(FTy->getNumParams());
+      addType(FTy->getReturnType(), Depth + 1);
+      for (FunctionType::param_iterator I = FTy->param_begin(), 
+          E = FTy->param_end(); I != E; ++I)
+        addType(*I, Depth + 1);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void FunctionHasher::addConstant(const Constant * C)
+{
+  addType(C->getType());
+  if (const GlobalValue * GV = dyn_cast<GlobalValue>(C)) {
+    // Global values are equivalent when they have the same name
+    add(GV->getName());
+    return;
+  }
+  if (const ConstantInt * CI = dyn_cast<ConstantInt>(C)) {
+    const APInt & V = CI->getValue();
+    for (unsigned i = 0, e = V.getNumWords(); i != e; ++i)
+      add(V.getRawData()[i]);
+    return;
+  }
+  if (const ConstantFP * CFP = dyn_cast<ConstantFP>(C)) {
+    APInt V = CFP->getValueAPF().bitcastToAPInt();
+    for (unsigned i = 0, e = V.getNumWords(); i != e; ++i)
+      add(V.getRawData()[i]);
+    return;
+  }
+  if (const BlockAddress * BA = dyn_cast<BlockAddress>(C)) {
+    add(BA->getFunction()->getName());
+    add(getNumber(BA->getBasicBlock()));
+    return;
+  }
+  if (const ConstantExpr * CE = dyn_cast<ConstantExpr>(C)) {
+    add(CE->getOpcode());
+    add(CE->getRawSubclassOptionalData());
+    if (CE->isCompare())
+      add(CE->getPredicate());
+    if (CE->hasIndices()) {
+      ArrayRef<unsigned> Indices = CE->getIndices();
+      for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+        add(Indices[i]);
+    }
+  }
+  // Aggregates and expressions
+  add(C->getNumOperands());
+  for (User::const_op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I)
+    addValue(*I);
+}
+
+void FunctionHasher::addValue(const Value * V)
+{
+  add(V->getValueID());
+  if (const Constant * C = dyn_cast<Constant>(V))
+    addConstant(C);
+  else if (isa<MDNode>(V) || isa<MDString>(V))
+    // Debug metadata is ignored
+    add(MetadataTag);
+  else if (const InlineAsm * IA = dyn_cast<InlineAsm>(V)) {
+    add(IA->getAsmString());
+    add(IA->getConstraintString());
+    add(IA->hasSideEffects());
+  }
+  else if (!Shallow)
+    // Arguments, instructions and basic blocks
+    add(getNumber(V));
+}
+
+void FunctionHasher::addInstruction(const Instruction * I)
+{
+  add(I->getOpcode());
+  addType(I->getType());
+  add(I->getRawSubclassOptionalData()); // nsw, nuw, exact, inbounds
+  if (!Shallow && !I->getType()->isVoidTy())
+    add(getNumber(I));
+
+  if (const CmpInst * CI = dyn_cast<CmpInst>(I))
+    add(CI->getPredicate());
+  else if (const LoadInst * LI = dyn_cast<LoadInst>(I)) {
+    add(LI->isVolatile());
+    add(LI->getAlignment());
+    add(LI->getOrdering());
+  }
+  else if (const StoreInst * SI = dyn_cast<StoreInst>(I)) {
+    add(SI->isVolatile());
+    add(SI->getAlignment());
+    add(SI->getOrdering());
+  }
+  else if (const AllocaInst * AI = dyn_cast<AllocaInst>(I)) {
+    addType(AI->getAllocatedType());
+    add(AI->getAlignment());
+  }
+  else if (const CallInst * CI = dyn_cast<CallInst>(I)) {
+    add(CI->getCallingConv());
+    add(CI->isTailCall());
+  }
+  else if (const InvokeInst * II = dyn_cast<InvokeInst>(I))
+    add(II->getCallingConv());
+  else if (const PHINode * PN = dyn_cast<PHINode>(I)) {
+    if (!Shallow)
+      for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
+        add(getNumber(PN->getIncomingBlock(i)));
+  }
+  else if (const ExtractValueInst * EVI = dyn_cast<ExtractValueInst>(I)) {
+    for (ExtractValueInst::idx_iterator II = EVI->idx_begin(), 
+        IE = EVI->idx_end(); II != IE; ++II)
+      add(*II);
+  }
+  else if (const InsertValueInst * IVI = dyn_cast<InsertValueInst>(I)) {
+    for (InsertValueInst::idx_iterator II = IVI->idx_begin(), 
+        IE = IVI->idx_end(); II != IE; ++II)
+      add(*II);
+  }
+  else if (const AtomicRMWInst * RMWI = dyn_cast<AtomicRMWInst>(I)) {
+    add(RMWI->getOperation());
+    add(RMWI->isVolatile());
+    add(RMWI->getOrdering());
+  }
+  else if (const AtomicCmpXchgInst * CXI = dyn_cast<AtomicCmpXchgInst>(I)) {
+    add(CXI->isVolatile());
+    add(CXI->getOrdering());
+  }
+  else if (const FenceInst * FI = dyn_cast<FenceInst>(I)) {
+    add(FI->getOrdering());
+    add(FI->getSynchScope());
+  }
+  else if (const LandingPadInst * LPI = dyn_cast<LandingPadInst>(I))
+    add(LPI->isCleanup());
+
+  add(I->getNumOperands());
+  for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE; ++OI)
+    addValue(*OI);
+}
+
+uint64_t FunctionHasher::hash(const Function * F)
+{
+  Hash = 0;
+  Numbering.clear();
+  addType(F->getFunctionType());
+  add(F->getCallingConv());
+  for (Function::const_arg_iterator I = F->arg_begin(), E = F->arg_end(); I != E; ++I)
+    getNumber(I);
+  for (Function::const_iterator BI = F->begin(), BE = F->end(); BI != BE; ++BI) {
+    add(BlockTag);
+    add(getNumber(BI));
+    for (BasicBlock::const_iterator I = BI->begin(), E = BI->end(); I != E; ++I)
+      addInstruction(I);
+  }
+  return Hash;
+}
+
+uint64_t FunctionHasher::hashShape(const Instruction * I)
+{
+  Hash = 0;
+  Numbering.clear();
+  Shallow = true;
+  addInstruction(I);
+  Shallow = false;
+  return Hash;
+}
+
+namespace llvm {
+
+uint64_t hashFunction(const Function * F)
+{
+  return FunctionHasher().hash(F);
+}
+
+} // End of llvm namespace
@@ -0,0 +1,150 @@
+/**
+ *  @file          FunctionSimilarity.cpp
+ *
+ *  @version       1.0
+ *  @created       03/18/2013 02:16:08 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Similarity fingerprints of functions for rename-tolerant matching.
+ *
+ */
+
+#include <set>
+
+#include "llvm/ADT/SmallVector.h"
+
+#include "analyzer/FunctionHash.h"
+#include "analyzer/FunctionSimilarity.h"
+
+using namespace llvm;
+
+#define SHINGLE_LEN 3 // instructions per n-gram
+
+#define FINGERPRINT_ROWS (FINGERPRINT_SIZE / FINGERPRINT_BANDS)
+
+static inline uint64_t mix(uint64_t x)
+{
+  // splitmix64 finalizer
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+FunctionFingerprint::FunctionFingerprint(const Function * F) : Size(0)
+{
+  for (unsigned k = 0; k < FINGERPRINT_SIZE; ++k)
+    MinHash[k] = 0xffffffffU;
+  FunctionHasher hasher;
+  SmallVector<uint64_t, 32> shapes;
+  for (Function::const_iterator BI = F->begin(), BE = F->end(); BI != BE; ++BI) {
+    shapes.clear();
+    for (BasicBlock::const_iterator I = BI->begin(), E = BI->end(); I != E; ++I)
+      shapes.push_back(hasher.hashShape(I));
+    Size += shapes.size();
+    // A block shorter than an n-gram is a single shingle
+    unsigned n = shapes.size() < SHINGLE_LEN ? 1 : shapes.size() - SHINGLE_LEN + 1;
+    for (unsigned i = 0; i < n; ++i) {
+      uint64_t shingle = 0;
+      for (unsigned j = i; j < i + SHINGLE_LEN && j < shapes.size(); ++j)
+        shingle = mix(shingle ^ shapes[j]);
+      // One hash function per slot, derived from the same mixer
+      for (unsigned k = 0; k < FINGERPRINT_SIZE; ++k) {
+        uint32_t h = (uint32_t) (mix(shingle + k * 0x9e3779b97f4a7c15ULL) >> 32);
+        if (h < MinHash[k])
+          MinHash[k] = h;
+      }
+    }
+  }
+}
+
+double FunctionFingerprint::similarity(const FunctionFingerprint & other) const
+{
+  unsigned equal = 0;
+  for (unsigned k = 0; k < FINGERPRINT_SIZE; ++k)
+    if (MinHash[k] == other.MinHash[k])
+      equal++;
+  return (double) equal / FINGERPRINT_SIZE;
+}
+
+uint64_t FunctionFingerprint::bandKey(unsigned band) const
+{
+  uint64_t key = mix(band + 1);
+  for (unsigned r = 0; r < FINGERPRINT_ROWS; ++r)
+    key = mix(key ^ MinHash[band * FINGERPRINT_ROWS + r]);
+  return key;
+}
+
+void SimilarityIndex::insert(Function * F)
+{
+  if (F->isDeclaration())
+    return;
+  FunctionFingerprint fp(F);
+  if (fp.Size < FINGERPRINT_MIN_INSTS)
+    return;
+  unsigned idx = Functions.size();
+  Functions.push_back(F);
+  Prints.push_back(fp);
+  Taken.push_back(false);
+  for (unsigned b = 0; b < FINGERPRINT_BANDS; ++b) {
+    std::vector<unsigned> & bucket = Buckets[fp.bandKey(b)];
+    // Overfull buckets hold generic code, e.g., accessors
+    if (bucket.size() < SIMINDEX_MAX_BUCKET)
+      bucket.push_back(idx);
+  }
+}
+
+Function * SimilarityIndex::findClosest(const Function * F, bool take, 
+    double * similarity)
+{
+  if (F->isDeclaration() || Functions.empty())
+    return NULL;
+  FunctionFingerprint fp(F);
+  if (fp.Size < FINGERPRINT_MIN_INSTS)
+    return NULL;
+  std::set<unsigned> seen;
+  unsigned best = 0;
+  double bestsim = -1;
+  for (unsigned b = 0; b < FINGERPRINT_BANDS && 
+      seen.size() < SIMINDEX_MAX_CANDIDATES; ++b) {
+    std::map<uint64_t, std::vector<unsigned> >::iterator it = 
+      Buckets.find(fp.bandKey(b));
+    if (it == Buckets.end())
+      continue;
+    for (std::vector<unsigned>::iterator I = it->second.begin(), 
+        E = it->second.end(); I != E && seen.size() < SIMINDEX_MAX_CANDIDATES; 
+        ++I) {
+      if (Taken[*I] || !seen.insert(*I).second)
+        continue;
+      double sim = fp.similarity(Prints[*I]);
+      if (sim > bestsim) {
+        best = *I;
+        bestsim = sim;
+      }
+    }
+  }
+  if (bestsim < SIMILARITY_THRESHOLD)
+    return NULL;
+  if (take)
+    Taken[best] = true;
+  if (similarity)
+    *similarity = bestsim;
+  return Functions[best];
+}
@@ -0,0 +1,152 @@
+/**
+ *  @file          CostSummary.cpp
+ *
+ *  @version       1.0
+ *  @created       03/14/2013 03:31:12 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Cost summary of a function.
+ *
+ */
+
+#include <algorithm>
+#include <string>
+#include <stdio.h>
+
+#include "llvm/Support/CallSite.h"
+
+#include "commons/handy.h"
+#include "analyzer/CostSummary.h"
+#include "analyzer/LoopSite.h"
+#include "analyzer/MemoryCost.h"
+
+using namespace llvm;
+
+namespace llvm {
+
+// Thresholds of LLVM's inliner
+const InlineThreshold InlineThresholds[INLINETHRESHOLDS] = {
+  {"-Os", 75},
+  {"-O2", 225},
+  {"-O3", 275},
+  {"inlinehint", 325}
+};
+
+const InlineThreshold * lostInlineThreshold(const FunctionCostSummary & Before,
+    const FunctionCostSummary & After)
+{
+  for (unsigned i = 0; i < INLINETHRESHOLDS; ++i) {
+    if (Before.InlineCost < InlineThresholds[i].Cost && 
+        After.InlineCost >= InlineThresholds[i].Cost)
+      return &InlineThresholds[i];
+  }
+  return NULL;
+}
+
+void printCostDelta(const char * funcname, const FunctionCostSummary & Before,
+    const FunctionCostSummary & After)
+{
+  printf("===='%s' cost delta====\n", funcname);
+  printf("static cost:\t%u -> %u\n", Before.StaticCost, After.StaticCost);
+  printf("weighted cost:\t%.1f -> %.1f\n", Before.WeightedCost, After.WeightedCost);
+  printf("expensive calls:\t%u -> %u\n", Before.ExpensiveCalls, After.ExpensiveCalls);
+  printf("frequent calls:\t%u -> %u\n", Before.FrequentCalls, After.FrequentCalls);
+  printf("code size:\t%u -> %u bytes\n", Before.CodeSize, After.CodeSize);
+  printf("inline cost:\t%u -> %u", Before.InlineCost, After.InlineCost);
+  const InlineThreshold * lost = lostInlineThreshold(Before, After);
+  if (lost)
+    printf(" (crosses the %s threshold %u)", lost->Name, lost->Cost);
+  printf("\n");
+}
+
+} // End of llvm namespace
+
+unsigned CostSummaryPass::getTripCount(Loop * L, ScalarEvolution * SE)
+{
+  unsigned count = getMaxTripCount(L, *SE);
+  if (count == 0)
+    return UNKNOWNTRIPCOUNT;
+  return count;
+}
+
+bool CostSummaryPass::inProfile(const Function * F, SpeFuncType type)
+{
+  if (profile == NULL)
+    return false;
+  Profile::iterator it = profile->find(type);
+  if (it == profile->end())
+    return false;
+  std::string name(cpp_demangle(F->getName().data()));
+  return std::binary_search(it->second.begin(), it->second.end(), name);
+}
+
+bool CostSummaryPass::runOnFunction(Function &F)
+{
+  LoopInfo * LI = &getAnalysis<LoopInfo>(); 
+  ScalarEvolution * SE = &getAnalysis<ScalarEvolution>(); 
+  MemoryCostAnalysis MCA(LI, SE);
+  cost_model->setMemoryCostAnalysis(&MCA);
+  cost_model->setScalarEvolution(SE, &F);
+
+  FunctionCostSummary & S = Summaries[&F];
+  S = FunctionCostSummary();
+  S.StaticCost = cost_model->getFunctionCost(&F);
+  std::map<Loop *, unsigned> trips;
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    double weight = 1;
+    for (Loop * L = LI->getLoopFor(BB); L; L = L->getParentLoop()) {
+      std::map<Loop *, unsigned>::iterator ti = trips.find(L);
+      if (ti == trips.end())
+        ti = trips.insert(std::make_pair(L, getTripCount(L, SE))).first;
+      weight *= ti->second;
+    }
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      unsigned cost = cost_model->getInstructionCost(I);
+      if (cost != (unsigned) -1)
+        S.WeightedCost += weight * cost;
+      unsigned size = cost_model->getInstructionSize(I);
+      S.CodeSize += size;
+      if (size)
+        S.InlineCost += INLINEINSTCOST;
+      if (!isa<CallInst>(I) && !isa<InvokeInst>(I))
+        continue;
+      ImmutableCallSite CS(&*I);
+      const Function * callee = CS.getCalledFunction();
+      if (callee && callee->isIntrinsic())
+        continue;
+      S.InlineCost += INLINECALLPENALTY;
+      if (callee == NULL)
+        continue;
+      if (inProfile(callee, SYSCALL) || inProfile(callee, LOCKCALL) || 
+          inProfile(callee, EXPCALL))
+        S.ExpensiveCalls++;
+      if (inProfile(callee, FREQCALL))
+        S.FrequentCalls++;
+    }
+  }
+
+  cost_model->setMemoryCostAnalysis(NULL);
+  cost_model->setScalarEvolution(NULL);
+  return false;
+}
+
+char CostSummaryPass::ID = 0;
+const char * CostSummaryPass::PassName = "Function cost summary";
@@ -33,6 +33,7 @@
 #include <queue>
 #include <string>
 #include <ctype.h>
+#include <sys/time.h>
 
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/IntrinsicInst.h"
@@ -43,7 +44,14 @@
 #include "commons/handy.h"
 #include "commons/CallSiteFinder.h"
 #include "commons/LLVMHelper.h"
+#include "analyzer/CostSummary.h"
 #include "analyzer/Evaluator.h"
+#include "analyzer/HotInfluence.h"
+#include "analyzer/LibCallCost.h"
+#include "analyzer/LoopSite.h"
+#include "analyzer/MemoryCost.h"
+#include "analyzer/RegisterPressure.h"
+#include "analyzer/Vectorizability.h"
 
 static int INDENT = 0;
 
@@ -152,8 +160,12 @@ RiskLevel RiskEvaluator::assess(const Instruction *I,  std::map<Loop *, unsigned
   eval_debug("\n");
   errind();
   if (isa<IntrinsicInst>(I)) {
-    eval_debug("intrinsic\n");
-    return NoRisk;
+    // Bulk-memory intrinsics in the cost database are assessed by size
+    const LibCallCostDB * db = cost_model ? cost_model->getLibCallCostDB() : NULL;
+    if (db == NULL || db->lookup(cast<CallInst>(I)) == NULL) {
+      eval_debug("intrinsic\n");
+      return NoRisk;
+    }
   }
   eval_debug("expensiveness:\n");
   Expensiveness exp = calcInstExp(I);
@@ -185,22 +197,34 @@ RiskLevel RiskEvaluator::assess(const Instruction *I,  std::map<Loop *, unsigned
   return RiskMatrix[hot][exp];
 }
 
+/// Memoized assess() of an instruction reached while evaluating F.
+/// Instructions of F depend on F's loops, which are the same every time.
+/// Those of other functions only on F's hotness and whether it has loops
+/// at all, so the slices of the functions of a change share them.
+RiskLevel RiskEvaluator::assessOnce(const Instruction *I, const Function *F,
+    std::map<Loop *, unsigned> & LoopDepthMap, Hotness FuncHotness)
+{
+  unsigned context = 0;
+  if (I->getParent()->getParent() != F)
+    context = 1 + FuncHotness * 2 + LocalLI->empty();
+  std::pair<const Instruction *, unsigned> key(I, context);
+  std::map<std::pair<const Instruction *, unsigned>, RiskLevel>::iterator it =
+    assessed.find(key);
+  if (it != assessed.end()) {
+    reassessed++;
+    return it->second;
+  }
+  RiskLevel risk = assess(I, LoopDepthMap, FuncHotness);
+  assessed[key] = risk;
+  return risk;
+}
+
 unsigned RiskEvaluator::getLoopDepth(Loop *L, std::map<Loop *, unsigned> & LoopDepthMap)
 {
   std::map<Loop *, unsigned>::iterator it = LoopDepthMap.find(L);
   if (it != LoopDepthMap.end())
     return it->second;
-  SmallVector<BasicBlock *, 4> exits;
-  L->getExitingBlocks(exits);
-  unsigned count = 0;
-  for (SmallVector<BasicBlock *, 4>::iterator ei = exits.begin(), ee = exits.end();
-      ei != ee; ++ei) {
-    if (*ei) {
-      unsigned c = SE->getSmallConstantTripCount(L, *ei); 
-      if (c > count)
-        count = c;
-    }
-  }
+  unsigned count = getMaxTripCount(L, *SE);
   LoopDepthMap[L] = count;
   return count;
 }
@@ -327,6 +351,15 @@ Hotness RiskEvaluator::calcCallerHotness(const Function * func, int level)
   return Regular;
 }
 
+static Expensiveness costToExp(unsigned cost)
+{
+  if (cost == 0 || cost == (unsigned) -1)
+    return Minor;
+  if (cost > INSTEXP)
+    return Expensive;
+  return Normal;
+}
+
 Expensiveness RiskEvaluator::calcInstExp(const Instruction * I)
 {
   Expensiveness exp = Minor;
@@ -335,7 +368,17 @@ Expensiveness RiskEvaluator::calcInstExp(const Instruction * I)
     const Value * called = CI->getCalledValue();
     if (const Function *F = dyn_cast<Function>(called)) { 
       if (!F->isIntrinsic())
-        return calcFuncExp(F);
+        exp = calcFuncExp(F);
+      // Calls with a size-aware cost, e.g., memcpy of a large buffer
+      const LibCallCostDB * db = cost_model ? cost_model->getLibCallCostDB() : NULL;
+      if (exp != Expensive && db && db->lookup(CI)) {
+        unsigned cost = cost_model->getInstructionCost(I); 
+        errind(2);
+        eval_debug("libcall cost: %u\n", cost);
+        Expensiveness cexp = costToExp(cost);
+        if (cexp > exp)
+          exp = cexp;
+      }
     }
     return exp;
   }
@@ -343,13 +386,7 @@ Expensiveness RiskEvaluator::calcInstExp(const Instruction * I)
     unsigned cost = cost_model->getInstructionCost(I); 
     errind(2);
     eval_debug("cost: %u\n", cost);
-    if (cost == 0 || cost == (unsigned) -1)
-      exp = Minor;
-    else
-      if (cost > INSTEXP)
-        exp = Expensive;
-      else
-        exp = Normal;
+    exp = costToExp(cost);
   }
   return exp;
 }
@@ -395,6 +432,132 @@ bool RiskEvaluator::isPerfSensitive(const BranchInst *I)
   return exps != 0 && exps != succs;
 }
 
+Function * RiskEvaluator::getBaseFunction(const Function &F)
+{
+  for (std::vector<Module *>::iterator I = base_modules.begin(), 
+      E = base_modules.end(); I != E; ++I) {
+    Function * BF = (*I)->getFunction(F.getName());
+    if (BF && !BF->isDeclaration())
+      return BF;
+  }
+  return NULL;
+}
+
+void RiskEvaluator::calcSpillRisk(Function &F, InstVecTy &inst_vec, 
+    SmallPtrSet<const Loop *, 4> &SlowLoops)
+{
+  RegisterPressureAnalysis RPA(cost_model);
+  std::vector<LoopPressure> after, before;
+  RPA.analyze(F, *LocalLI, after);
+  Function * BF = getBaseFunction(F);
+  if (BF) {
+    FunctionPassManager FPM(BF->getParent());
+    FPM.add(new LoopPressurePass(&RPA, before));
+    FPM.doInitialization();
+    FPM.run(*BF);
+    FPM.doFinalization();
+  }
+  // Only the loops touched by the change are of interest
+  SmallPtrSet<const Loop *, 4> modified;
+  for (InstVecIter I = inst_vec.begin(), E = inst_vec.end(); I != E; I++) {
+    for (Loop * L = LocalLI->getLoopFor((*I)->getParent()); L; L = L->getParentLoop())
+      modified.insert(L);
+  }
+  for (unsigned i = 0; i < after.size(); ++i) {
+    const Loop * L = LocalLI->getLoopFor(after[i].Header);
+    if (!modified.count(L))
+      continue;
+    unsigned spills = RPA.getSpills(after[i]);
+    const LoopPressure * old = BF ? RPA.match(after[i], i, before) : NULL;
+    unsigned oldspills = old ? RPA.getSpills(*old) : 0;
+    printf("loop@%u register pressure: %u/%u scalar, %u/%u vector", after[i].Line,
+        after[i].Scalar, RPA.getNumberOfRegisters(false), 
+        after[i].Vector, RPA.getNumberOfRegisters(true));
+    if (old)
+      printf(" (before: %u scalar, %u vector)", old->Scalar, old->Vector);
+    printf(", %u predicted spills\n", spills);
+    if (spills > oldspills)
+      SlowLoops.insert(L);
+  }
+}
+
+void RiskEvaluator::calcVectorRisk(Function &F, InstVecTy &inst_vec, 
+    SmallPtrSet<const Loop *, 4> &SlowLoops)
+{
+  Function * BF = getBaseFunction(F);
+  if (BF == NULL)
+    return;
+  VectorizationLegality VL(cost_model);
+  std::vector<LoopVectorization> after, before;
+  VL.analyze(F, *LocalLI, *SE, getAnalysis<DominatorTree>(), after);
+  FunctionPassManager FPM(BF->getParent());
+  FPM.add(new LoopVectorizationPass(&VL, before));
+  FPM.doInitialization();
+  FPM.run(*BF);
+  FPM.doFinalization();
+  SmallPtrSet<const Loop *, 4> modified;
+  for (InstVecIter I = inst_vec.begin(), E = inst_vec.end(); I != E; I++) {
+    for (Loop * L = LocalLI->getLoopFor((*I)->getParent()); L; L = L->getParentLoop())
+      modified.insert(L);
+  }
+  for (unsigned i = 0; i < after.size(); ++i) {
+    const Loop * L = LocalLI->getLoopFor(after[i].Header);
+    if (!modified.count(L))
+      continue;
+    const LoopVectorization * old = VL.match(after[i], i, before);
+    if (old == NULL || !old->isVectorizable() || after[i].isVectorizable())
+      continue;
+    // The loop now runs Width times as many iterations
+    printf("loop@%u was vectorizable (width %u) and no longer is: %s\n", 
+        after[i].Line, old->Width, toVectorBlockerStr(after[i].Blocker));
+    if (after[i].Culprit)
+      eval_debug("blocked by %s\n", after[i].Culprit->getOpcodeName());
+    SlowLoops.insert(L);
+  }
+}
+
+void RiskEvaluator::setCodeGrowth(const Function * F, unsigned growth, bool lostInline)
+{
+  // A lost inlining adds the call overhead to every call, growth adds
+  // icache and iTLB pressure
+  Expensiveness exp = Minor;
+  if (lostInline)
+    exp = Expensive;
+  else if (growth >= CODEGROWTHBYTES)
+    exp = Normal;
+  Hotness hot = calcCallerHotness(F, depth);
+  printf("code growth: %u bytes in %s function%s\n", growth, toHotStr(hot), 
+      lostInline ? ", no longer inlined" : "");
+  if (exp > Minor)
+    risk_floors[F] = RiskMatrix[hot][exp];
+}
+
+RiskLevel RiskEvaluator::assessLoopRegression(const Instruction *I, SmallPtrSet<const Loop *, 4> &SlowLoops, 
+    std::map<Loop *, unsigned> & LoopDepthMap, Hotness FuncHotness)
+{
+  for (Loop * L = LocalLI->getLoopFor(I->getParent()); L; L = L->getParentLoop()) {
+    if (SlowLoops.count(L)) {
+      eval_debug("regressed loop\n");
+      // Spill code or lost vectorization slows down every iteration
+      if (FuncHotness == Hot)
+        return RiskMatrix[Hot][Expensive];
+      return RiskMatrix[calcInstHotness(I, LoopDepthMap)][Expensive];
+    }
+  }
+  return NoRisk;
+}
+
+bool RiskEvaluator::pastDeadline()
+{
+  if (deadline <= 0)
+    return false;
+  if (!partial) {
+    struct timeval tim;
+    gettimeofday(&tim, NULL);
+    partial = tim.tv_sec * 1000.0 + (tim.tv_usec/1000.0) > deadline;
+  }
+  return partial;
+}
 
 bool RiskEvaluator::runOnFunction(Function &F)
 {
@@ -405,6 +568,11 @@ bool RiskEvaluator::runOnFunction(Function &F)
   memset(FuncRiskStat, 0, sizeof(FuncRiskStat));
   LocalLI = &getAnalysis<LoopInfo>(); 
   SE = &getAnalysis<ScalarEvolution>(); 
+  MemoryCostAnalysis MCA(LocalLI, SE);
+  if (cost_model) {
+    cost_model->setMemoryCostAnalysis(&MCA);
+    cost_model->setScalarEvolution(SE, &F);
+  }
   INDENT = 4;
   InstVecTy &inst_vec = m_inst_map[&F];
   std::map<Loop *, unsigned> LoopDepthMap;
@@ -426,60 +594,103 @@ bool RiskEvaluator::runOnFunction(Function &F)
     graph = builder->getDepGraph();
   }
 #endif
-  if (level > 1) {
-    InstVecIter I = inst_vec.begin(), E = inst_vec.end();
-    slicer->addCriteria(&F, I, E);
-    slicer->computeSlice();
+  // Loops whose predicted spills grow, or that are no longer
+  // vectorizable, with the change; removing code makes neither worse
+  SmallPtrSet<const Loop *, 4> SlowLoops;
+  if (cost_model && !removed && !LocalLI->empty() && !pastDeadline()) {
+    calcSpillRisk(F, inst_vec, SlowLoops);
+    calcVectorRisk(F, inst_vec, SlowLoops);
   }
+  RiskLevel cap = ExtremeRisk;
+  std::map<const Function *, RiskLevel>::iterator cap_it = risk_caps.find(&F);
+  if (cap_it != risk_caps.end())
+    cap = cap_it->second;
+  RiskLevel minrisk = NoRisk;
+  std::map<const Function *, RiskLevel>::iterator minrisk_it = risk_floors.find(&F);
+  if (minrisk_it != risk_floors.end())
+    minrisk = minrisk_it->second;
+
+  // The modified instructions themselves go first, they are the closest
+  // to the change and the cheapest to assess, so they are assessed even
+  // past the deadline
+  FuncHotInfluenced = 0;
+  std::vector<RiskLevel> maxes;
   for (InstVecIter I = inst_vec.begin(), E = inst_vec.end(); I != E; I++) {
     Instruction* inst = *I;
-    RiskLevel max = assess(inst, LoopDepthMap, funcHot);
+    RiskLevel max = assessOnce(inst, &F, LoopDepthMap, funcHot);
     errind();
     eval_debug("%s\n", toRiskStr(max));
+    if (!SlowLoops.empty()) {
+      RiskLevel r = assessLoopRegression(inst, SlowLoops, LoopDepthMap, funcHot);
+      if (r > max)
+        max = r;
+    }
+    maxes.push_back(max);
+  }
 
-    if (level > 1) {
-      const Instruction * propagate;
-      eval_debug("Evaluating slice...\n");
-      while ((propagate = slicer->next()) != NULL) {
-        RiskLevel r = assess(propagate, LoopDepthMap, funcHot);
-        //We could break once we reach ExtremeRisk
-        //But we just iterate all over it for now
-        if (r > max)
-          max = r;
-        errind();
-        eval_debug("%s\n", toRiskStr(r));
+  // The slice is accounted to the first instruction. It is only computed
+  // if it can still raise the risk, and its functions come in the order
+  // the slice reached them, the nearest first.
+  if (level > 1 && !maxes.empty() && maxes[0] < cap && !pastDeadline()) {
+    InstVecIter I = inst_vec.begin(), E = inst_vec.end();
+    slicer->addCriteria(&F, I, E);
+    slicer->computeSlice();
+    if (slicer->isPartial())
+      partial = true;
+    const Instruction * propagate;
+    eval_debug("Evaluating slice...\n");
+    while ((propagate = slicer->next()) != NULL) {
+      // the modified instructions, and whatever earlier slices reached,
+      // come out of the memo
+      RiskLevel r = assessOnce(propagate, &F, LoopDepthMap, funcHot);
+      if (r > maxes[0])
+        maxes[0] = r;
+      errind();
+      eval_debug("%s\n", toRiskStr(r));
+      // nothing left to learn once the cap is reached
+      if (maxes[0] >= cap || pastDeadline()) {
+        slicer->releaseSlice();
+        break;
       }
-      eval_debug("Slice evaluation done.\n");
     }
-#if 0
-    if (graph != NULL) {
-      Slicer slicer(graph, Criterion(0, inst, true, AllDep));
-      Instruction * propagate;
-      eval_debug("Evaluating slice...\n");
-      while ((propagate = slicer.next()) != NULL) {
-        RiskLevel r = assess(propagate, LoopDepthMap, funcHot);
-        //We could break once we reach ExtremeRisk
-        //But we just iterate all over it for now
-        if (r > max)
-          max = r;
-        errind();
-        eval_debug("%s\n", toRiskStr(r));
-      }
-      eval_debug("Slice evaluation done.\n");
+    eval_debug("Slice evaluation done.\n");
+  }
+
+  for (unsigned i = 0; i < maxes.size(); ++i) {
+    RiskLevel max = maxes[i];
+    if (max < minrisk) {
+      eval_debug("raised to %s\n", toRiskStr(minrisk));
+      max = minrisk;
+    }
+    if (max > cap) {
+      eval_debug("capped to %s\n", toRiskStr(cap));
+      max = cap;
+    }
+    // How often hot code runs is beyond the cost comparison behind the
+    // cap, so the flag is applied after it
+    if (hot_influence && hot_influence->influences(inst_vec[i])) {
+      eval_debug("feeds a hot loop bound or branch condition\n");
+      FuncHotInfluenced++;
+      if (max < HighRisk)
+        max = HighRisk;
     }
-#endif
 
     //We only count slice once, otherwise the output doesn't make
     //much sense.
     FuncRiskStat[max]++;
     AllRiskStat[max]++;
   }
+  AllHotInfluenced += FuncHotInfluenced;
   statFuncRisk(cpp_demangle(F.getName().data()));
 #if 0
   if (level > 1) {
     FPasses->doFinalization();
   }
 #endif
+  if (cost_model) {
+    cost_model->setMemoryCostAnalysis(NULL);
+    cost_model->setScalarEvolution(NULL);
+  }
   return false;
 }
 
@@ -492,14 +703,22 @@ inline void RiskEvaluator::statPrint(unsigned stat[RISKLEVELS])
 
 void RiskEvaluator::statFuncRisk(const char * funcname)
 {
-  printf("===='%s' risk summary====\n", funcname);
+  printf("===='%s' %srisk summary%s====\n", funcname, removed ? "removed code " : "",
+      partial ? " (partial)" : "");
   statPrint(FuncRiskStat);
+  if (FuncHotInfluenced)
+    printf("Feeding hot conditions:\t%u\n", FuncHotInfluenced);
 }
 
 void RiskEvaluator::statAllRisk()
 {
-  printf("====Overall risk summary====\n");
+  printf("====Overall %srisk summary%s====\n", removed ? "removed code " : "",
+      partial ? " (partial, time budget exhausted)" : "");
   statPrint(AllRiskStat);
+  if (AllHotInfluenced)
+    printf("Feeding hot conditions:\t%u\n", AllHotInfluenced);
+  eval_debug("%u instructions assessed, %u assessments reused\n",
+      (unsigned) assessed.size(), reassessed);
 }
 
 
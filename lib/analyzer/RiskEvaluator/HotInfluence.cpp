@@ -0,0 +1,122 @@
+/**
+ *  @file          HotInfluence.cpp
+ *
+ *  @version       1.0
+ *  @created       03/22/2013 04:33:02 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Instructions that decide the trip counts of hot loops and the
+ *  direction of hot branches, see HotInfluence.h
+ *
+ */
+
+#include <algorithm>
+
+#include "llvm/PassManager.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "commons/handy.h"
+#include "analyzer/Evaluator.h"
+#include "analyzer/HotInfluence.h"
+#include "analyzer/LoopSite.h"
+
+namespace llvm {
+
+/// A loop is hot when its trip count is above the threshold of a tight
+/// loop, as in RiskEvaluator::calcInstHotness. Unlike there, a loop with
+/// an unknown trip count is only hot when nested deep enough, otherwise
+/// nearly every loop branch would become a criterion.
+bool HotConditionPass::isHotLoop(Loop * L, ScalarEvolution & SE)
+{
+  unsigned count = getMaxTripCount(L, SE);
+  if (count == 0)
+    return L->getLoopDepth() >= HOTLOOPDEPTH;
+  return count > LOOPCOUNTTIGHT;
+}
+
+bool HotConditionPass::runOnFunction(Function &F)
+{
+  LoopInfo &LI = getAnalysis<LoopInfo>();
+  ScalarEvolution &SE = getAnalysis<ScalarEvolution>();
+  bool hotFunc = false;
+  if (profile) {
+    Profile::iterator it = profile->find(FREQCALL);
+    if (it != profile->end())
+      hotFunc = std::binary_search(it->second.begin(), it->second.end(), 
+          cpp_demangle(F.getName().data()));
+  }
+  std::map<Loop *, bool> hotLoops;
+  for (Function::iterator FI = F.begin(), FE = F.end(); FI != FE; ++FI) {
+    TerminatorInst * TI = FI->getTerminator();
+    if (TI == NULL)
+      continue;
+    if (BranchInst * BI = dyn_cast<BranchInst>(TI)) {
+      if (BI->isUnconditional())
+        continue;
+    } else if (!isa<SwitchInst>(TI))
+      continue;
+    // a branch of an inner loop is hot if any loop around it is
+    bool hot = hotFunc;
+    for (Loop * L = LI.getLoopFor(FI); L && !hot; L = L->getParentLoop()) {
+      std::map<Loop *, bool>::iterator it = hotLoops.find(L);
+      if (it == hotLoops.end())
+        it = hotLoops.insert(std::make_pair(L, isHotLoop(L, SE))).first;
+      hot = it->second;
+    }
+    if (hot)
+      Conds[&F].push_back(TI);
+  }
+  return false;
+}
+
+HotInfluence::HotInfluence(Module * M, slicing::StaticSlicer * slicer, 
+    Profile * profile) : Conditions(0), Partial(false)
+{
+  HotConditionPass::CondMapTy conds;
+  FunctionPassManager FPM(M);
+  FPM.add(new HotConditionPass(profile, conds));
+  FPM.doInitialization();
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F) {
+    if (!F->isDeclaration())
+      FPM.run(*F);
+  }
+  FPM.doFinalization();
+  if (conds.empty())
+    return;
+
+  // One slice for all the conditions, they share most of it
+  slicer->setForward(false);
+  for (HotConditionPass::CondMapTy::iterator it = conds.begin(), 
+      ie = conds.end(); it != ie; ++it) {
+    slicer->addCriteria(it->first, it->second.begin(), it->second.end());
+    Conditions += it->second.size();
+  }
+  slicer->computeSlice();
+  Partial = slicer->isPartial();
+  const Instruction * I;
+  while ((I = slicer->next()) != NULL)
+    Influence.insert(I);
+  slicer->setForward(true);
+}
+
+char HotConditionPass::ID = 0;
+const char * HotConditionPass::PassName = "Hot loop and branch conditions";
+} // End of llvm namespace
@@ -0,0 +1,189 @@
+; ModuleID = 'opcodes.bc'
+; One instance of every opcode the cost model should price
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.__va_list_tag = type { i32, i32, i8*, i8* }
+%struct.pair = type { i32, i64 }
+
+@targets = internal constant [2 x i8*] [i8* blockaddress(@indirect, %l0), i8* blockaddress(@indirect, %l1)], align 16
+
+define i32 @arith(i32 %a, i32 %b, double %x, double %y) nounwind uwtable {
+entry:
+  %add = add nsw i32 %a, %b
+  %sub = sub nsw i32 %add, %b
+  %mul = mul nsw i32 %sub, %a
+  %udiv = udiv i32 %mul, %b
+  %sdiv = sdiv i32 %udiv, %b
+  %urem = urem i32 %sdiv, %b
+  %srem = srem i32 %urem, %b
+  %shl = shl i32 %srem, 2
+  %lshr = lshr i32 %shl, 1
+  %ashr = ashr i32 %lshr, 1
+  %and = and i32 %ashr, %a
+  %or = or i32 %and, %b
+  %xor = xor i32 %or, %a
+  %fadd = fadd double %x, %y
+  %fsub = fsub double %fadd, %y
+  %fmul = fmul double %fsub, %x
+  %fdiv = fdiv double %fmul, %y
+  %frem = frem double %fdiv, %y
+  %cmp = icmp slt i32 %xor, %a
+  %fcmp = fcmp olt double %frem, %x
+  %both = and i1 %cmp, %fcmp
+  %sel = select i1 %both, i32 %xor, i32 %a
+  ret i32 %sel
+}
+
+define i64 @casts(i32 %a, double %x, i8* %p) nounwind uwtable {
+entry:
+  %zext = zext i32 %a to i64
+  %sext = sext i32 %a to i64
+  %trunc = trunc i64 %sext to i16
+  %fptoui = fptoui double %x to i32
+  %fptosi = fptosi double %x to i32
+  %uitofp = uitofp i32 %fptoui to double
+  %sitofp = sitofp i32 %fptosi to float
+  %fpext = fpext float %sitofp to double
+  %fptrunc = fptrunc double %uitofp to float
+  %ptrtoint = ptrtoint i8* %p to i64
+  %inttoptr = inttoptr i64 %ptrtoint to i32*
+  %bitcast = bitcast i32* %inttoptr to i8*
+  %r = add i64 %zext, %ptrtoint
+  ret i64 %r
+}
+
+define i32 @memory(%struct.pair* %s, i32 %i) nounwind uwtable {
+entry:
+  %tmp = alloca i32, align 4
+  %idx = sext i32 %i to i64
+  %f0 = getelementptr inbounds %struct.pair* %s, i64 %idx, i32 0
+  %v = load i32* %f0, align 4
+  store i32 %v, i32* %tmp, align 4
+  %old = atomicrmw add i32* %f0, i32 1 seq_cst
+  %prev = cmpxchg i32* %f0, i32 %old, i32 %v acquire
+  fence acquire
+  fence seq_cst
+  %al = load atomic i32* %f0 acquire, align 4
+  store atomic i32 %al, i32* %tmp seq_cst, align 4
+  store atomic i32 %prev, i32* %tmp release, align 4
+  %r = load i32* %tmp, align 4
+  ret i32 %r
+}
+
+define <4 x i32> @vector(<4 x i32> %a, <4 x i32> %b, i32 %x) nounwind uwtable {
+entry:
+  %e = extractelement <4 x i32> %a, i32 1
+  %s = add i32 %e, %x
+  %ins = insertelement <4 x i32> %b, i32 %s, i32 0
+  %bcast = shufflevector <4 x i32> %ins, <4 x i32> undef, <4 x i32> zeroinitializer
+  %rev = shufflevector <4 x i32> %bcast, <4 x i32> undef, <4 x i32> <i32 3, i32 2, i32 1, i32 0>
+  %mix = shufflevector <4 x i32> %rev, <4 x i32> %a, <4 x i32> <i32 0, i32 5, i32 2, i32 7>
+  ret <4 x i32> %mix
+}
+
+define i64 @aggregate(i32 %a, i64 %b) nounwind uwtable {
+entry:
+  %p0 = insertvalue %struct.pair undef, i32 %a, 0
+  %p1 = insertvalue %struct.pair %p0, i64 %b, 1
+  %f = extractvalue %struct.pair %p1, 1
+  ret i64 %f
+}
+
+define i32 @switches(i32 %a) nounwind uwtable {
+entry:
+  ; dense enough for a jump table
+  switch i32 %a, label %sparse [
+    i32 0, label %dense.0
+    i32 1, label %dense.1
+    i32 2, label %dense.2
+    i32 3, label %dense.3
+    i32 5, label %dense.0
+  ]
+
+sparse:
+  ; lowered to a compare tree
+  switch i32 %a, label %small [
+    i32 10, label %dense.0
+    i32 1000, label %dense.1
+    i32 100000, label %dense.2
+    i32 10000000, label %dense.3
+  ]
+
+small:
+  switch i32 %a, label %done [
+    i32 -1, label %dense.1
+  ]
+
+dense.0:
+  br label %done
+
+dense.1:
+  br label %done
+
+dense.2:
+  br label %done
+
+dense.3:
+  br label %done
+
+done:
+  %r = phi i32 [ 0, %small ], [ 1, %dense.0 ], [ 2, %dense.1 ], [ 3, %dense.2 ], [ 4, %dense.3 ]
+  ret i32 %r
+}
+
+define i32 @indirect(i32 %i) nounwind uwtable {
+entry:
+  %idx = sext i32 %i to i64
+  %slot = getelementptr inbounds [2 x i8*]* @targets, i64 0, i64 %idx
+  %target = load i8** %slot, align 8
+  indirectbr i8* %target, [label %l0, label %l1]
+
+l0:
+  ret i32 0
+
+l1:
+  ret i32 1
+}
+
+define i32 @variadic(i32 %n, ...) nounwind uwtable {
+entry:
+  %ap = alloca [1 x %struct.__va_list_tag], align 16
+  %ap1 = bitcast [1 x %struct.__va_list_tag]* %ap to i8*
+  call void @llvm.va_start(i8* %ap1)
+  %v = va_arg i8* %ap1, i32
+  call void @llvm.va_end(i8* %ap1)
+  ret i32 %v
+}
+
+declare void @llvm.va_start(i8*) nounwind
+
+declare void @llvm.va_end(i8*) nounwind
+
+declare void @may_throw(i32)
+
+declare void @abort() noreturn nounwind
+
+declare i32 @__gxx_personality_v0(...)
+
+define void @exceptions(i32 %a) uwtable {
+entry:
+  invoke void @may_throw(i32 %a)
+          to label %cont unwind label %lpad
+
+cont:
+  %bad = icmp slt i32 %a, 0
+  br i1 %bad, label %fail, label %ok
+
+ok:
+  ret void
+
+fail:
+  call void @abort() noreturn nounwind
+  unreachable
+
+lpad:
+  %exn = landingpad { i8*, i32 } personality i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*)
+          cleanup
+  resume { i8*, i32 } %exn
+}
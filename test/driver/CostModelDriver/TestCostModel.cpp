@@ -56,6 +56,7 @@
 using namespace llvm;
 
 X86CostModel * XCM = NULL;
+unsigned UnknownCount = 0;
 
 struct CostModelDriver : public FunctionPass {
   static char ID;
@@ -68,6 +69,13 @@ struct CostModelDriver : public FunctionPass {
   virtual bool runOnFunction(Function &F) {
     assert(XCM && "Cost model cannot be NULL");
     errs() << F.getNameStr() << "\n";
+    // Every opcode should be covered by the cost model
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      if (XCM->getInstructionCost(&*I) == (unsigned) -1) {
+        errs() << "Unknown cost for" << *I << "\n";
+        UnknownCount++;
+      }
+    }
     unsigned cost = XCM->getFunctionCost(&F);
     errs() << "Cost: " << cost << "\n";
     return false;
@@ -141,6 +149,10 @@ int main(int argc, char **argv)
     PM.add(new TargetData(*TD));
   PM.add(new CostModelDriver()); 
   PM.run(*M);
+  if (UnknownCount) {
+    errs() << UnknownCount << " instructions with unknown cost\n";
+    return 1;
+  }
   return 0;
 }
 
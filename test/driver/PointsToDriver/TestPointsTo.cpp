@@ -0,0 +1,152 @@
+/**
+ *  @file          TestPointsTo.cpp
+ *
+ *  @version       1.0
+ *  @created       03/22/2013 10:12:38 AM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Benchmark of the points-to solvers: runs the round-based fixpoint, the
+ *  worklist solver and the union-find solver on the same module, prints
+ *  their running time and checks that each result covers the previous one.
+ *
+ */
+
+#include <sys/time.h>
+
+#include "llvm/Constants.h"
+#include "llvm/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "llvmslicer/PointsTo.h"
+
+using namespace llvm;
+
+static cl::opt<unsigned> FixpointRounds("pts-rounds",
+       cl::desc("Rounds of the fixpoint solver, 0 to run until it converges"),
+       cl::init(1));
+
+static double now()
+{
+  struct timeval tim;
+  gettimeofday(&tim, NULL);
+  return tim.tv_sec * 1000.0 + (tim.tv_usec / 1000.0);
+}
+
+static unsigned long countPairs(const ptr::PointsToSets &S)
+{
+  unsigned long pairs = 0;
+  for (ptr::PointsToSets::const_iterator I = S.begin(), E = S.end(); I != E; ++I)
+    pairs += I->second.size();
+  return pairs;
+}
+
+static void printStats(const ptr::PointsToStats &stats)
+{
+  errs() << "  " << stats.Nodes << " nodes, " << stats.Constraints
+    << " constraints, " << stats.Collapsed << " collapsed, "
+    << stats.Propagations << " propagations, " << stats.SharedSets
+    << " distinct sets\n";
+}
+
+/// Counts the pairs of Small missing from Big, null pointees aside since
+/// the union-find solver does not track them.
+static unsigned long countMissing(const ptr::PointsToSets &Small,
+    const ptr::PointsToSets &Big, const char *name)
+{
+  unsigned long missing = 0;
+  for (ptr::PointsToSets::const_iterator I = Small.begin(), E = Small.end();
+      I != E; ++I) {
+    const ptr::PointsToSets::PointsToSet &S = ptr::getPointsToSet(I->first, Big);
+    for (ptr::PointsToSets::PointsToSet::const_iterator SI = I->second.begin(),
+        SE = I->second.end(); SI != SE; ++SI)
+      if (!S.count(*SI) && !isa<ConstantPointerNull>(*SI)) {
+        if (missing++ < 10) {
+          errs() << "missing: ";
+          I->first->print(errs());
+          errs() << " -> ";
+          (*SI)->print(errs());
+          errs() << "\n";
+        }
+      }
+  }
+  errs() << missing << " pairs missing from the " << name << " result\n";
+  return missing;
+}
+
+namespace {
+
+  class PointsToTest: public ModulePass {
+
+    public:
+      static char ID; // Pass identification, replacement for typeid
+      PointsToTest() : ModulePass(ID) {}
+
+      virtual bool runOnModule(Module &M)
+      {
+        double t1 = now();
+        ptr::ProgramStructure P(M);
+        double t2 = now();
+        errs() << "rule codes: " << P.size() << ", " << format("%.4f ms\n", t2 - t1);
+
+        ptr::PointsToSets Old;
+        t1 = now();
+        ptr::fixpointPointsToSets(P, Old, FixpointRounds);
+        t2 = now();
+        errs() << "fixpoint (" << FixpointRounds << " rounds): " << Old.getContainer().size()
+          << " sets, " << countPairs(Old) << " pairs, " << format("%.4f ms\n", t2 - t1);
+
+        ptr::PointsToSets New;
+        ptr::PointsToStats stats;
+        t1 = now();
+        ptr::solvePointsToSets(P, New, &stats);
+        t2 = now();
+        errs() << "worklist: " << New.getContainer().size() << " sets, "
+          << countPairs(New) << " pairs, " << format("%.4f ms\n", t2 - t1);
+        printStats(stats);
+
+        ptr::PointsToSets Unified;
+        ptr::PointsToStats ustats;
+        t1 = now();
+        ptr::unifyPointsToSets(P, Unified, &ustats);
+        t2 = now();
+        errs() << "unification: " << Unified.getContainer().size() << " sets, "
+          << countPairs(Unified) << " pairs, " << format("%.4f ms\n", t2 - t1);
+        printStats(ustats);
+
+        // every pair the fixpoint found, even after a single round, must be
+        // in the worklist result, and every worklist pair in the unified one
+        countMissing(Old, New, "worklist");
+        countMissing(New, Unified, "unification");
+        return false;
+      }
+
+      virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+        AU.setPreservesAll();
+      }
+  };
+
+}
+
+char PointsToTest::ID = 0;
+static RegisterPass<PointsToTest> X("tpointsto", "Points-to Solver Benchmark");
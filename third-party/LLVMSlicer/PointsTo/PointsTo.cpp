@@ -171,7 +171,7 @@ namespace llvm { namespace ptr {
       PTSet &X = S[*i];
       const std::size_t old_size = X.size();
 
-      L.insert(rval);
+      X.insert(rval);
       change = change || X.size() != old_size;
     }
 
@@ -263,7 +263,8 @@ namespace llvm { namespace ptr {
 #define MAX_IT 1 // it takes too long (or infinite loop) for large 
                  // program to converge
 
-  static PointsToSets &fixpoint(const ProgramStructure &P, PointsToSets &S)
+  static PointsToSets &fixpoint(const ProgramStructure &P, PointsToSets &S,
+      unsigned maxIt)
   {
     bool change;
     unsigned it = 0;
@@ -276,13 +277,23 @@ namespace llvm { namespace ptr {
 #ifdef DEBUG_POINTS
       errs() << "it #" << it << "\n";
 #endif
-    } while (change && it < MAX_IT);
+    } while (change && (maxIt == 0 || it < maxIt));
 
     return S;
   }
 
-  PointsToSets &computePointsToSets(const ProgramStructure &P, PointsToSets &S) {
-    return pruneByType(fixpoint(P, S));
+  PointsToSets &fixpointPointsToSets(const ProgramStructure &P,
+      PointsToSets &S, unsigned maxIt) {
+    return pruneByType(fixpoint(P, S, maxIt));
+  }
+
+  PointsToSets &computePointsToSets(const ProgramStructure &P, PointsToSets &S,
+      PointsToSolver solver) {
+    if (solver == PTS_FIXPOINT)
+      return fixpointPointsToSets(P, S, MAX_IT);
+    if (solver == PTS_UNIFICATION)
+      return unifyPointsToSets(P, S);
+    return solvePointsToSets(P, S);
   }
 
   const PointsToSets::PointsToSet &
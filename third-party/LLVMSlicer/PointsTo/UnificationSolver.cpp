@@ -0,0 +1,224 @@
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Unification-based (Steensgaard) solver for the rule codes of a
+// ProgramStructure. Values are grouped into equivalence classes with a
+// union-find, and every class points to at most one other class. An
+// assignment joins the classes pointed to by both sides instead of adding
+// an inclusion edge, so each rule is applied once, in near-linear time:
+//
+//   a = &b        join(*a, b)
+//   a = b         join(*a, *b)
+//   a = *b        join(*a, **b)
+//   *a = b        join(**a, *b)
+//   *a = &b       join(**a, b)
+//   *a = *b       join(**a, **b)
+//
+// The sets are coarser than the inclusion-based ones, every value of a
+// class gets the same points-to set, but one pass over the rules is enough.
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "llvm/Function.h"
+#include "llvm/Value.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "llvmslicer/PointsTo.h"
+#include "llvmslicer/RuleExpressions.h"
+
+//#define DEBUG_SOLVER
+
+#define NO_POINTEE 0xffffffffU
+
+namespace llvm { namespace ptr {
+
+namespace {
+
+  class UnionFind {
+  public:
+    UnionFind() : Unions(0) {}
+
+    unsigned getNode(const Value *V);
+    unsigned newNode();
+    unsigned find(unsigned N);
+    unsigned pointee(unsigned N);
+    void join(unsigned A, unsigned B);
+    void exportSets(PointsToSets &S, unsigned &Shared);
+
+    unsigned size() const { return Parent.size(); }
+
+    unsigned Unions;
+
+  private:
+    std::vector<unsigned> Parent;
+    std::vector<unsigned> Rank;
+    std::vector<unsigned> Pointee;
+    std::vector<const Value *> Values;  // NULL for pointee placeholders
+    DenseMap<const Value *, unsigned> Ids;
+  };
+
+}
+
+unsigned UnionFind::newNode() {
+  unsigned N = Parent.size();
+  Parent.push_back(N);
+  Rank.push_back(0);
+  Pointee.push_back(NO_POINTEE);
+  Values.push_back(NULL);
+  return N;
+}
+
+unsigned UnionFind::getNode(const Value *V) {
+  DenseMap<const Value *, unsigned>::iterator it = Ids.find(V);
+  if (it != Ids.end())
+    return it->second;
+  unsigned N = newNode();
+  Values[N] = V;
+  Ids[V] = N;
+  return N;
+}
+
+unsigned UnionFind::find(unsigned N) {
+  unsigned R = N;
+  while (Parent[R] != R)
+    R = Parent[R];
+  while (Parent[N] != R) {
+    unsigned Next = Parent[N];
+    Parent[N] = R;
+    N = Next;
+  }
+  return R;
+}
+
+/// The class N points to, a placeholder is created if it has none yet.
+unsigned UnionFind::pointee(unsigned N) {
+  N = find(N);
+  if (Pointee[N] == NO_POINTEE) {
+    unsigned P = newNode();
+    Pointee[N] = P;
+    return P;
+  }
+  return find(Pointee[N]);
+}
+
+/// Unifies two classes and, in turn, the classes they point to. A pending
+/// list replaces the recursion of the textbook version.
+void UnionFind::join(unsigned A, unsigned B) {
+  std::vector<std::pair<unsigned, unsigned> > Pending;
+  Pending.push_back(std::make_pair(A, B));
+  while (!Pending.empty()) {
+    unsigned X = find(Pending.back().first);
+    unsigned Y = find(Pending.back().second);
+    Pending.pop_back();
+    if (X == Y)
+      continue;
+    if (Rank[X] < Rank[Y])
+      std::swap(X, Y);
+    else if (Rank[X] == Rank[Y])
+      ++Rank[X];
+    Parent[Y] = X;
+    ++Unions;
+    if (Pointee[X] == NO_POINTEE)
+      Pointee[X] = Pointee[Y];
+    else if (Pointee[Y] != NO_POINTEE)
+      Pending.push_back(std::make_pair(Pointee[X], Pointee[Y]));
+    Pointee[Y] = NO_POINTEE;
+  }
+}
+
+/// Every value gets the members of the class its own class points to.
+/// The set of a class is built once and shared by all values pointing to it.
+void UnionFind::exportSets(PointsToSets &S, unsigned &Shared) {
+  typedef PointsToSets::PointsToSet PTSet;
+  std::map<unsigned, PTSet> Members;
+  for (unsigned N = 0; N < Values.size(); ++N)
+    if (Values[N])
+      Members[find(N)].insert(Values[N]);
+
+  Shared = 0;
+  for (unsigned N = 0; N < Values.size(); ++N) {
+    const Value *V = Values[N];
+    // functions are pruned, as pruneByType does for the other solvers
+    if (V == NULL || isa<Function>(V))
+      continue;
+    unsigned P = Pointee[find(N)];
+    if (P == NO_POINTEE)
+      continue;
+    std::map<unsigned, PTSet>::const_iterator it = Members.find(find(P));
+    if (it == Members.end())
+      continue;
+    PTSet &L = S[V];
+    if (L.empty())
+      L = it->second;
+    else
+      L.insert(it->second.begin(), it->second.end());
+  }
+  for (std::map<unsigned, PTSet>::const_iterator I = Members.begin(),
+      E = Members.end(); I != E; ++I)
+    if (Pointee[I->first] != NO_POINTEE)
+      ++Shared;
+}
+
+PointsToSets &unifyPointsToSets(const ProgramStructure &P, PointsToSets &S,
+    PointsToStats *stats) {
+  UnionFind U;
+  unsigned constraints = 0;
+  for (ProgramStructure::const_iterator i = P.begin(); i != P.end(); ++i) {
+    const RuleCode &RC = *i;
+    unsigned L, R;
+    switch (RC.getType()) {
+      case RCT_VAR_ASGN_ALLOC:
+      case RCT_VAR_ASGN_REF_VAR:
+        L = U.pointee(U.getNode(RC.getLvalue()));
+        R = U.getNode(RC.getRvalue());
+        break;
+      case RCT_VAR_ASGN_VAR:
+        L = U.pointee(U.getNode(RC.getLvalue()));
+        R = U.pointee(U.getNode(RC.getRvalue()));
+        break;
+      case RCT_VAR_ASGN_DREF_VAR:
+        L = U.pointee(U.getNode(RC.getLvalue()));
+        R = U.pointee(U.pointee(U.getNode(RC.getRvalue())));
+        break;
+      case RCT_DREF_VAR_ASGN_VAR:
+        L = U.pointee(U.pointee(U.getNode(RC.getLvalue())));
+        R = U.pointee(U.getNode(RC.getRvalue()));
+        break;
+      case RCT_DREF_VAR_ASGN_REF_VAR:
+        L = U.pointee(U.pointee(U.getNode(RC.getLvalue())));
+        R = U.getNode(RC.getRvalue());
+        break;
+      case RCT_DREF_VAR_ASGN_DREF_VAR:
+        L = U.pointee(U.pointee(U.getNode(RC.getLvalue())));
+        R = U.pointee(U.pointee(U.getNode(RC.getRvalue())));
+        break;
+      default:
+        // null is not an object, unifying on it would make every pointer
+        // ever set to null alias each other
+        continue;
+    }
+    U.join(L, R);
+    ++constraints;
+  }
+
+  unsigned shared = 0;
+  U.exportSets(S, shared);
+
+#ifdef DEBUG_SOLVER
+  errs() << "points-to: " << U.size() << " nodes, " << U.Unions
+    << " unions, " << shared << " classes pointed to\n";
+#endif
+  if (stats) {
+    stats->Nodes = U.size();
+    stats->Constraints = constraints;
+    stats->Collapsed = U.Unions;
+    stats->Propagations = 0;
+    stats->SharedSets = shared;
+  }
+  return S;
+}
+
+}}
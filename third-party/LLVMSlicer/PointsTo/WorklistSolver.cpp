@@ -0,0 +1,411 @@
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Inclusion-based solver for the rule codes of a ProgramStructure. Every
+// value gets a dense number and its points-to set is a sparse bitset over
+// those numbers. The rules become constraints of four kinds:
+//
+//   a = &b        base:   pts(a) contains b
+//   a = b         copy:   pts(a) includes pts(b), an edge b -> a
+//   a = *b        load:   for each o in pts(b), an edge o -> a
+//   *a = b        store:  for each o in pts(a), an edge b -> o
+//
+// and are solved with a worklist. A node only pushes the part of its set
+// that it has not pushed before (difference propagation), and copy cycles
+// are found lazily, when an edge joins two nodes with equal sets, and
+// collapsed into a single node. The final sets are hash-consed so nodes
+// with the same solution share one PointsToSet while being copied out.
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "llvm/Function.h"
+#include "llvm/Value.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "llvmslicer/PointsTo.h"
+#include "llvmslicer/RuleExpressions.h"
+
+//#define DEBUG_SOLVER
+
+namespace llvm { namespace ptr {
+
+namespace {
+
+  typedef SparseBitVector<> Bits;
+
+  struct ConstraintNode {
+    Bits Pts;                       // current solution
+    Bits Done;                      // part of Pts already propagated
+    Bits Succs;                     // copy edges, this -> succ
+    std::vector<unsigned> Loads;    // d = *this
+    std::vector<unsigned> Stores;   // *this = s
+    std::vector<unsigned> Addrs;    // *this = &a
+  };
+
+  class ConstraintGraph {
+  public:
+    ConstraintGraph() : Collapsed(0), Propagations(0) {}
+
+    unsigned getNode(const Value *V);
+    unsigned newTemp();
+
+    void addBase(unsigned A, unsigned B) { Nodes[A].Pts.set(B); }
+    void addCopy(unsigned From, unsigned To) {
+      if (From != To)
+        Nodes[From].Succs.set(To);
+    }
+    void addLoad(unsigned Dst, unsigned Ptr) {
+      Nodes[Ptr].Loads.push_back(Dst);
+    }
+    void addStore(unsigned Ptr, unsigned Src) {
+      Nodes[Ptr].Stores.push_back(Src);
+    }
+    void addAddrStore(unsigned Ptr, unsigned Obj) {
+      Nodes[Ptr].Addrs.push_back(Obj);
+    }
+
+    void solve();
+    void exportSets(PointsToSets &S, unsigned &Shared);
+
+    unsigned size() const { return Nodes.size(); }
+
+    unsigned Collapsed;
+    unsigned Propagations;
+
+  private:
+    unsigned find(unsigned N);
+    void push(unsigned N);
+    void propagate(unsigned N);
+    bool link(unsigned From, unsigned To);
+    bool collapseCycles(unsigned Root);
+    void merge(unsigned Into, unsigned From);
+
+    std::vector<ConstraintNode> Nodes;
+    std::vector<const Value *> Values;  // NULL for temporaries
+    std::vector<unsigned> Rep;
+    DenseMap<const Value *, unsigned> Ids;
+
+    std::deque<unsigned> Worklist;
+    std::vector<bool> Queued;
+    std::set<std::pair<unsigned, unsigned> > Checked;
+  };
+
+  struct DfsFrame {
+    unsigned Node;
+    SmallVector<unsigned, 8> Succs;
+    unsigned Next;
+
+    explicit DfsFrame(unsigned N) : Node(N), Next(0) {}
+  };
+
+}
+
+unsigned ConstraintGraph::getNode(const Value *V) {
+  DenseMap<const Value *, unsigned>::iterator it = Ids.find(V);
+  if (it != Ids.end())
+    return it->second;
+  unsigned N = Nodes.size();
+  Nodes.push_back(ConstraintNode());
+  Values.push_back(V);
+  Rep.push_back(N);
+  Ids[V] = N;
+  return N;
+}
+
+unsigned ConstraintGraph::newTemp() {
+  unsigned N = Nodes.size();
+  Nodes.push_back(ConstraintNode());
+  Values.push_back(NULL);
+  Rep.push_back(N);
+  return N;
+}
+
+unsigned ConstraintGraph::find(unsigned N) {
+  unsigned R = N;
+  while (Rep[R] != R)
+    R = Rep[R];
+  while (Rep[N] != R) {
+    unsigned Next = Rep[N];
+    Rep[N] = R;
+    N = Next;
+  }
+  return R;
+}
+
+void ConstraintGraph::push(unsigned N) {
+  if (!Queued[N]) {
+    Queued[N] = true;
+    Worklist.push_back(N);
+  }
+}
+
+/// Adds a copy edge found while solving. The target gets what the source
+/// has already propagated, the rest follows when the source is processed.
+bool ConstraintGraph::link(unsigned From, unsigned To) {
+  if (From == To || !Nodes[From].Succs.test_and_set(To))
+    return false;
+  if (Nodes[To].Pts |= Nodes[From].Done)
+    push(To);
+  return true;
+}
+
+void ConstraintGraph::merge(unsigned Into, unsigned From) {
+  ConstraintNode &I = Nodes[Into];
+  ConstraintNode &F = Nodes[From];
+  Rep[From] = Into;
+  I.Pts |= F.Pts;
+  // whatever one of them has not propagated yet is propagated again
+  I.Done &= F.Done;
+  I.Succs |= F.Succs;
+  I.Loads.insert(I.Loads.end(), F.Loads.begin(), F.Loads.end());
+  I.Stores.insert(I.Stores.end(), F.Stores.begin(), F.Stores.end());
+  I.Addrs.insert(I.Addrs.end(), F.Addrs.begin(), F.Addrs.end());
+  F.Pts.clear();
+  F.Done.clear();
+  F.Succs.clear();
+  std::vector<unsigned>().swap(F.Loads);
+  std::vector<unsigned>().swap(F.Stores);
+  std::vector<unsigned>().swap(F.Addrs);
+  ++Collapsed;
+}
+
+/// Tarjan's algorithm over the copy edges reachable from Root, without
+/// recursion since copy chains in large modules get deep. Every strongly
+/// connected component found is merged into one node.
+bool ConstraintGraph::collapseCycles(unsigned Root) {
+  DenseMap<unsigned, unsigned> Index;
+  DenseMap<unsigned, unsigned> Low;
+  DenseSet<unsigned> Finished;
+  std::vector<unsigned> Stack;
+  std::vector<DfsFrame> Dfs;
+  unsigned Counter = 0;
+  bool Changed = false;
+
+  Dfs.push_back(DfsFrame(Root));
+  while (!Dfs.empty()) {
+    DfsFrame &F = Dfs.back();
+    unsigned V = F.Node;
+    if (F.Next == 0 && !Index.count(V)) {
+      Index[V] = Low[V] = Counter++;
+      Stack.push_back(V);
+      for (Bits::iterator I = Nodes[V].Succs.begin(),
+          E = Nodes[V].Succs.end(); I != E; ++I)
+        F.Succs.push_back(find(*I));
+    }
+    if (F.Next < F.Succs.size()) {
+      unsigned W = F.Succs[F.Next++];
+      if (W == V || Finished.count(W))
+        continue;
+      if (!Index.count(W))
+        Dfs.push_back(DfsFrame(W));
+      else if (Index[W] < Low[V])
+        Low[V] = Index[W];
+      continue;
+    }
+    Dfs.pop_back();
+    if (!Dfs.empty()) {
+      unsigned P = Dfs.back().Node;
+      if (Low[V] < Low[P])
+        Low[P] = Low[V];
+    }
+    if (Low[V] != Index[V])
+      continue;
+    unsigned W;
+    do {
+      W = Stack.back();
+      Stack.pop_back();
+      Finished.insert(W);
+      if (W != V) {
+        merge(V, W);
+        Changed = true;
+      }
+    } while (W != V);
+    if (Changed)
+      push(V);
+  }
+  return Changed;
+}
+
+void ConstraintGraph::propagate(unsigned N) {
+  Bits Delta;
+  Delta.intersectWithComplement(Nodes[N].Pts, Nodes[N].Done);
+  if (Delta.empty())
+    return;
+  Nodes[N].Done |= Delta;
+  ++Propagations;
+
+  // complex constraints only see the new pointees
+  for (Bits::iterator I = Delta.begin(), E = Delta.end(); I != E; ++I) {
+    unsigned O = find(*I);
+    ConstraintNode &C = Nodes[N];
+    for (unsigned i = 0; i < C.Loads.size(); ++i)
+      link(O, find(C.Loads[i]));
+    for (unsigned i = 0; i < C.Stores.size(); ++i)
+      link(find(C.Stores[i]), O);
+    for (unsigned i = 0; i < C.Addrs.size(); ++i)
+      if (Nodes[O].Pts.test_and_set(C.Addrs[i]))
+        push(O);
+  }
+
+  SmallVector<unsigned, 16> Succs;
+  SmallVector<unsigned, 4> Suspects;
+  for (Bits::iterator I = Nodes[N].Succs.begin(),
+      E = Nodes[N].Succs.end(); I != E; ++I)
+    Succs.push_back(*I);
+  for (unsigned i = 0; i < Succs.size(); ++i) {
+    unsigned T = find(Succs[i]);
+    if (T == N)
+      continue;
+    if (Nodes[T].Pts |= Delta)
+      push(T);
+    // lazy cycle detection: equal sets across an edge hint at a cycle
+    if (Nodes[T].Pts == Nodes[N].Pts &&
+        Checked.insert(std::make_pair(N, T)).second)
+      Suspects.push_back(T);
+  }
+  // collapse only once N is done, merging keeps the common propagated part
+  for (unsigned i = 0; i < Suspects.size(); ++i) {
+    unsigned T = find(Suspects[i]);
+    if (T != find(N))
+      collapseCycles(T);
+  }
+}
+
+void ConstraintGraph::solve() {
+  Queued.assign(Nodes.size(), false);
+  for (unsigned N = 0; N < Nodes.size(); ++N)
+    if (!Nodes[N].Pts.empty())
+      push(N);
+  while (!Worklist.empty()) {
+    unsigned N = Worklist.front();
+    Worklist.pop_front();
+    Queued[N] = false;
+    if (find(N) == N)
+      propagate(N);
+  }
+}
+
+static unsigned hashBits(const Bits &B) {
+  unsigned H = 2166136261U;
+  for (Bits::iterator I = B.begin(), E = B.end(); I != E; ++I)
+    H = (H ^ *I) * 16777619U;
+  return H;
+}
+
+/// Copies the solution out. Equal sets are hash-consed so each distinct
+/// set is converted to a PointsToSet once.
+void ConstraintGraph::exportSets(PointsToSets &S, unsigned &Shared) {
+  typedef PointsToSets::PointsToSet PTSet;
+  std::multimap<unsigned, unsigned> Buckets;  // hash -> index in Pool
+  std::vector<const Bits *> Pool;
+  std::vector<PTSet> Sets;
+  std::vector<int> SetOf(Nodes.size(), -1);
+
+  for (unsigned N = 0; N < Nodes.size(); ++N) {
+    const Value *V = Values[N];
+    // functions are pruned, as pruneByType does for the old solver
+    if (V == NULL || isa<Function>(V))
+      continue;
+    unsigned R = find(N);
+    const Bits &B = Nodes[R].Pts;
+    if (B.empty())
+      continue;
+    if (SetOf[R] < 0) {
+      unsigned H = hashBits(B);
+      typedef std::multimap<unsigned, unsigned>::iterator BucketIter;
+      std::pair<BucketIter, BucketIter> range = Buckets.equal_range(H);
+      for (BucketIter I = range.first; I != range.second; ++I)
+        if (*Pool[I->second] == B) {
+          SetOf[R] = I->second;
+          break;
+        }
+      if (SetOf[R] < 0) {
+        SetOf[R] = Pool.size();
+        Buckets.insert(std::make_pair(H, Pool.size()));
+        Pool.push_back(&B);
+        Sets.push_back(PTSet());
+        PTSet &X = Sets.back();
+        for (Bits::iterator I = B.begin(), E = B.end(); I != E; ++I)
+          if (Values[*I])
+            X.insert(Values[*I]);
+      }
+    }
+    const PTSet &X = Sets[SetOf[R]];
+    PTSet &L = S[V];
+    if (L.empty())
+      L = X;
+    else
+      L.insert(X.begin(), X.end());
+  }
+  Shared = Sets.size();
+}
+
+PointsToSets &solvePointsToSets(const ProgramStructure &P, PointsToSets &S,
+    PointsToStats *stats) {
+  ConstraintGraph G;
+  unsigned constraints = 0;
+  for (ProgramStructure::const_iterator i = P.begin(); i != P.end(); ++i) {
+    const RuleCode &RC = *i;
+    if (RC.getType() == RCT_DEALLOC || RC.getType() == RCT_UNKNOWN)
+      continue;
+    unsigned L = G.getNode(RC.getLvalue());
+    unsigned R = G.getNode(RC.getRvalue());
+    ++constraints;
+    switch (RC.getType()) {
+      case RCT_VAR_ASGN_ALLOC:
+      case RCT_VAR_ASGN_NULL:
+      case RCT_VAR_ASGN_REF_VAR:
+        G.addBase(L, R);
+        break;
+      case RCT_VAR_ASGN_VAR:
+        G.addCopy(R, L);
+        break;
+      case RCT_VAR_ASGN_DREF_VAR:
+        G.addLoad(L, R);
+        break;
+      case RCT_DREF_VAR_ASGN_NULL:
+      case RCT_DREF_VAR_ASGN_REF_VAR:
+        G.addAddrStore(L, R);
+        break;
+      case RCT_DREF_VAR_ASGN_VAR:
+        G.addStore(L, R);
+        break;
+      case RCT_DREF_VAR_ASGN_DREF_VAR: {
+        // *a = *b goes through a temporary: t = *b; *a = t
+        unsigned T = G.newTemp();
+        G.addLoad(T, R);
+        G.addStore(L, T);
+        break;
+      }
+      default:
+        assert(0);
+    }
+  }
+
+  G.solve();
+  unsigned shared = 0;
+  G.exportSets(S, shared);
+
+#ifdef DEBUG_SOLVER
+  errs() << "points-to: " << G.size() << " nodes, " << G.Collapsed
+    << " collapsed, " << G.Propagations << " propagations, " << shared
+    << " distinct sets\n";
+#endif
+  if (stats) {
+    stats->Nodes = G.size();
+    stats->Constraints = constraints;
+    stats->Collapsed = G.Collapsed;
+    stats->Propagations = G.Propagations;
+    stats->SharedSets = shared;
+  }
+  return S;
+}
+
+}}
@@ -23,10 +23,13 @@
 #include "llvm/Module.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/TypeBuilder.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/Support/CFG.h"
 #include "llvm/Support/InstIterator.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
@@ -58,7 +61,8 @@ void slicing::printVal(const Value *val) {
 }
 
 InsInfo::InsInfo(const Instruction *i, const ptr::PointsToSets &PS,
-    const mods::Modifies &MOD) : ins(i), sliced(true) {
+    const mods::Modifies &MOD, ValueIndex &index) : ins(i), index(&index),
+    sliced(true) {
   typedef ptr::PointsToSets::PointsToSet PTSet;
 
   if (const LoadInst *LI = dyn_cast<const LoadInst>(i)) {
@@ -265,6 +269,30 @@ InsInfo::InsInfo(const Instruction *i, const ptr::PointsToSets &PS,
   }
 }
 
+bool InsInfo::mergeRC(const ValBits &vals, const ValBits *mask) {
+  bool changed = false;
+  for (unsigned w = 0, e = vals.numWords(); w < e; ++w) {
+    ValBits::Word bits = vals.word(w) & ~RCBits.word(w);
+    if (mask)
+      bits &= ~mask->word(w);
+    if (!bits)
+      continue;
+    RCBits.orWord(w, bits);
+    // only the values new to RC go to the list
+    for (; bits; bits &= bits - 1) {
+      unsigned id = w * ValBits::WordBits + CountTrailingZeros_64(bits);
+#ifdef DEBUG_RC
+      errs() << "\tRC";
+      index->getValue(id)->print(errs());
+      errs() << ": Added\n";
+#endif
+      RC.insert(index->getValue(id));
+    }
+    changed = true;
+  }
+  return changed;
+}
+
 namespace {
   class FunctionSlicer : public ModulePass {
     public:
@@ -287,26 +315,60 @@ namespace {
 static RegisterPass<FunctionSlicer> X("slice", "Slices the code");
 char FunctionSlicer::ID;
 
-FunctionStaticSlicer::~FunctionStaticSlicer() {
-  for (InsInfoMap::const_iterator I = insInfoMap.begin(), E = insInfoMap.end();
-      I != E; I++)
-    delete I->second;
-}
-
-typedef llvm::SmallVector<const Instruction *, 10> SuccList;
+/*
+ * Instructions are numbered by the reverse post-order of their blocks, so
+ * that following the numbers visits definitions before their uses in the
+ * forward direction and the other way around in the backward one. Blocks
+ * that cannot be reached from the entry come last. The successors of each
+ * instruction are resolved to numbers once, for all the RC iterations.
+ */
+FunctionStaticSlicer::FunctionStaticSlicer(Function &F, ModulePass *MP,
+    const ptr::PointsToSets &PT, const mods::Modifies &mods, bool forward) :
+  fun(F), MP(MP), prepared(false), summaries(NULL), forward(forward) {
+  std::vector<BasicBlock *> blocks;
+  SmallPtrSet<BasicBlock *, 32> seen;
+  if (!F.empty()) {
+    ReversePostOrderTraversal<Function *> RPOT(&F);
+    for (ReversePostOrderTraversal<Function *>::rpo_iterator I = RPOT.begin(),
+        E = RPOT.end(); I != E; ++I) {
+      blocks.push_back(*I);
+      seen.insert(*I);
+    }
+  }
+  for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I)
+    if (!seen.count(I))
+      blocks.push_back(I);
+
+  for (std::vector<BasicBlock *>::const_iterator I = blocks.begin(),
+      E = blocks.end(); I != E; ++I)
+    for (BasicBlock::iterator II = (*I)->begin(), EE = (*I)->end(); II != EE;
+        ++II) {
+      insIndex[II] = insInfos.size();
+      insInfos.push_back(new InsInfo(II, PT, mods, values));
+    }
 
-static SuccList getSuccList(const Instruction *i) {
-  SuccList succList;
-  const BasicBlock *bb = i->getParent();
-  if (i != &bb->back()) {
-    BasicBlock::const_iterator I(i);
-    I++;
-    succList.push_back(&*I);
-  } else {
-    for (succ_const_iterator I = succ_begin(bb), E = succ_end(bb); I != E; I++)
-      succList.push_back(&(*I)->front());
+  succs.resize(insInfos.size());
+  preds.resize(insInfos.size());
+  for (unsigned i = 0, e = insInfos.size(); i < e; ++i) {
+    const Instruction *ins = insInfos[i]->getIns();
+    const BasicBlock *bb = ins->getParent();
+    if (ins != &bb->back()) {
+      succs[i].push_back(i + 1);
+    } else {
+      for (succ_const_iterator I = succ_begin(bb), E = succ_end(bb); I != E;
+          I++)
+        succs[i].push_back(insIndex[&(*I)->front()]);
+    }
+    for (EdgeList::const_iterator I = succs[i].begin(), E = succs[i].end();
+        I != E; ++I)
+      preds[*I].push_back(i);
   }
-  return succList;
+}
+
+FunctionStaticSlicer::~FunctionStaticSlicer() {
+  for (std::vector<InsInfo *>::const_iterator I = insInfos.begin(),
+      E = insInfos.end(); I != E; I++)
+    delete *I;
 }
 
 bool FunctionStaticSlicer::sameValues(const Value *val1, const Value *val2)
@@ -344,8 +406,6 @@ bool FunctionStaticSlicer::computeRCi(InsInfo *insInfoi, InsInfo *insInfoj) {
 #endif
 
 
-  bool changed = false;
-
   InsInfo *ii, *ij;
   if (!forward) { // backward 
     ii = insInfoi;
@@ -356,98 +416,89 @@ bool FunctionStaticSlicer::computeRCi(InsInfo *insInfoi, InsInfo *insInfoj) {
     ij = insInfoi;
   }
 
-  ValSet::const_iterator I, E;
-
   /* Backward: {v| v \in RC(j), v \notin DEF(i)} */
   /* Forward:  {v| v \in RC(i), v \notin DEF(j)} */
-  for (I = ij->RC_begin(), E = ij->RC_end(); I != E; I++) {
-    const Value *RCj = *I;
-#ifdef DEBUG_RC
-    errs() << "\tRC";
-    RCj->print(errs());
-    // printVal(RCj);
-    errs() << ": ";
-#endif
-    bool in_DEF = false;
-    for (ValSet::const_iterator II = ii->DEF_begin(),
-        EE = ii->DEF_end(); II != EE; II++)
-      if (sameValues(*II, RCj)) {
-        in_DEF = true;
-        break;
-      }
-    if (!in_DEF) {
-#ifdef DEBUG_RC
-      errs() << "Kept\n";
-#endif
-      if (ii->addRC(RCj)) {
-        changed = true;
-      }
-    }
-    else {
-#ifdef DEBUG_RC
-      errs() << "Removed\n";
-#endif
-    }
-  }
-
-  /* Backward: DEF(i) \cap RC(j) \neq \emptyset */
-  /* Forward: REF(j) \cap RC(i) \neq \emptyset */
-  bool isect_nonempty = false;
-  if (!forward) {
-    I = ii->DEF_begin();
-    E = ii->DEF_end();
-  }
-  else {
-    I = ii->REF_begin();
-    E = ii->REF_end();
-  }
-  for (; I != E && !isect_nonempty; I++) {
-    const Value *VALi = *I; // VAL could be DEF or REF
-    for (ValSet::const_iterator II = ij->RC_begin(),
-        EE = ij->RC_end(); II != EE; II++) {
-      if (sameValues(VALi, *II)) {
-        isect_nonempty = true;
-        break;
-      }
-    }
-  }
+  bool changed = ii->mergeRC(ij->RC_bits(), &ii->DEF_bits());
 
-  /* Backward: {v| v \in REF(i), ...} */
-  /* Forward:  {v| v \in DEF(j), ...} */
-  if (!forward) {
-    I = ii->REF_begin();
-    E = ii->REF_end();
-  }
-  else {
-    I = ii->DEF_begin();
-    E = ii->DEF_end();
-  }
+  /* Backward: {v| v \in REF(i), DEF(i) \cap RC(j) \neq \emptyset} */
+  /* Forward:  {v| v \in DEF(j), REF(j) \cap RC(i) \neq \emptyset} */
+  bool isect_nonempty = !forward ?
+    ii->DEF_bits().intersects(ij->RC_bits()) :
+    ii->REF_bits().intersects(ij->RC_bits());
   if (isect_nonempty) {
-    for (; I != E; I++)
-      if (ii->addRC(*I)) {
-        changed = true;
-#ifdef DEBUG_RC
-        errs() << "\tRC"; 
-        // printVal(*I);
-        (*I)->print(errs());
-        errs() << ": Added \n";
-#endif
-      }
+    if (const CallSummary *CS = getCallSummary(ii->getIns()))
+      changed |= applySummary(ii, ij, *CS);
+    else
+      changed |= ii->mergeRC(!forward ? ii->REF_bits() : ii->DEF_bits());
   }
   return changed;
 }
 
+const CallSummary *FunctionStaticSlicer::getCallSummary(
+    const Instruction *i) const {
+  if (summaries == NULL || !isa<CallInst>(i))
+    return NULL;
+  CallSummaries::const_iterator it = summaries->find(cast<CallInst>(i));
+  return it == summaries->end() ? NULL : &it->second;
+}
+
+bool FunctionStaticSlicer::isRelevant(const ValBits &RC,
+    const Value *V) const {
+  unsigned id;
+  return values.findId(V, id) && RC.test(id);
+}
+
 /*
- * Backward, Forward: get successors
- * 
+ * Calls with a summary only relate the arguments to the outputs of the
+ * callees that actually depend on them, instead of every argument to the
+ * whole mod set.
+ *
+ * Backward: {a_k| (ret \in RC(j) and k reaches ret) or
+ *                 (m \in RC(j) and k reaches m)}
+ * Forward:  {ret, m| a_k \in RC(i), k reaches ret, m}
+ *
+ * Arguments past the summary, i.e., variadic ones, and relevant function
+ * pointers fall back to the plain rule.
  */
-bool FunctionStaticSlicer::computeRCi(InsInfo *insInfoi) {
-  const Instruction *i = insInfoi->getIns();
+bool FunctionStaticSlicer::applySummary(InsInfo *ii, const InsInfo *ij,
+    const CallSummary &CS) {
+  const CallInst *C = cast<CallInst>(ii->getIns());
+  const Value *callie = C->getCalledValue();
+  const ValBits &RC = ij->RC_bits();
   bool changed = false;
-  SuccList succList = getSuccList(i);
-  SuccList::const_iterator I = succList.begin(), E = succList.end();
-  for (;I != E; I++)
-    changed |= computeRCi(insInfoi, getInsInfo(*I));
+  if (!forward) {
+    for (unsigned k = 0, e = C->getNumArgOperands(); k < e; ++k) {
+      const Value *arg = C->getArgOperand(k);
+      if (isConstantValue(arg))
+        continue;
+      bool reaches = k >= CS.size();
+      if (!reaches) {
+        reaches = CS[k].returns && isRelevant(RC, C);
+        for (ValSet::const_iterator I = CS[k].mods.begin(),
+            E = CS[k].mods.end(); !reaches && I != E; ++I)
+          reaches = isRelevant(RC, *I);
+      }
+      if (reaches)
+        changed |= ii->addRC(arg);
+    }
+    if (!isa<Function>(callie))
+      changed |= ii->addRC(callie);
+    return changed;
+  }
+
+  if (!isa<Function>(callie) && isRelevant(RC, callie))
+    return ii->mergeRC(ii->DEF_bits());
+  for (unsigned k = 0, e = C->getNumArgOperands(); k < e; ++k) {
+    if (!isRelevant(RC, C->getArgOperand(k)))
+      continue;
+    if (k >= CS.size())
+      return ii->mergeRC(ii->DEF_bits()) || changed;
+    if (CS[k].returns && !callToVoidFunction(C))
+      changed |= ii->addRC(C);
+    for (ValSet::const_iterator I = CS[k].mods.begin(), E = CS[k].mods.end();
+        I != E; ++I)
+      changed |= ii->addRC(*I);
+  }
   return changed;
 }
 
@@ -455,53 +506,45 @@ bool FunctionStaticSlicer::computeRCi(InsInfo *insInfoi) {
  * Backward: Bottom-up
  * Forward:  Top-down
  *
+ * Only the instructions whose input changed are revisited. The worklist
+ * is kept ordered by instruction number, so every round follows the
+ * reverse post-order (forward) or the post-order (backward) of the CFG.
  */
 void FunctionStaticSlicer::computeRC() {
-  bool changed;
+  std::set<unsigned> worklist;
+  for (unsigned i = 0, e = insInfos.size(); i < e; ++i)
+    worklist.insert(i);
 #ifdef DEBUG_RC
-  int it = 1;
+  int it = 0;
 #endif
-  do {
-    changed = false;
+  while (!worklist.empty()) {
 #ifdef DEBUG_RC
-    errs() << "======BEG RC Iteration " << it << "======\n";
-#endif
-    if (!forward) { // backward slicing, work on in bottom-up fashion
-      typedef std::reverse_iterator<Function::iterator> revFun;
-      for (revFun I = revFun(fun.end()), E = revFun(fun.begin()); I != E; I++) {
-        typedef std::reverse_iterator<BasicBlock::iterator> rev;
-        InsInfo *past = NULL;
-        for (rev II = rev(I->end()), EE = rev(I->begin()); II != EE; ++II) {
-          InsInfo *insInfo = getInsInfo(&*II);
-          if (!past)
-            changed |= computeRCi(insInfo);
-          else
-            changed |= computeRCi(insInfo, past);
-          past = insInfo;
-        }
-      }
-    } 
-    else { // forward slicing, work on in top-down fashion
-      Function::iterator FI, FE;
-      for (FI = fun.begin(), FE = fun.end(); FI != FE; ++FI) {
-        BasicBlock::iterator BI = FI->begin(), BE = FI->end();
-        if (BI == BE) // empty block
-          continue;
-        InsInfo *past = getInsInfo(&*BI);
-        BI++;
-        for (; BI != BE; ++BI) {
-          InsInfo *insInfo = getInsInfo(&*BI);
-          changed |= computeRCi(past, insInfo);
-          past = insInfo;
-        }
-        changed |= computeRCi(past);
-      }
+    it++;
+#endif
+    if (!forward) { // backward: RC(i) from RC of the successors
+      std::set<unsigned>::iterator last = --worklist.end();
+      unsigned i = *last;
+      worklist.erase(last);
+      bool changed = false;
+      for (EdgeList::const_iterator I = succs[i].begin(), E = succs[i].end();
+          I != E; ++I)
+        changed |= computeRCi(insInfos[i], insInfos[*I]);
+      if (changed)
+        worklist.insert(preds[i].begin(), preds[i].end());
+    }
+    else { // forward: RC of the successors from RC(i)
+      unsigned i = *worklist.begin();
+      worklist.erase(worklist.begin());
+      for (EdgeList::const_iterator I = succs[i].begin(), E = succs[i].end();
+          I != E; ++I)
+        if (computeRCi(insInfos[i], insInfos[*I]))
+          worklist.insert(*I);
     }
+  }
 #ifdef DEBUG_RC
-    errs() << "======END RC Iteration " << it << "======\n";
-    it++;
+  errs() << "======END RC: " << it << " visits of " << insInfos.size()
+    << " instructions======\n";
 #endif
-  } while (changed);
 }
 
 /*
@@ -513,41 +556,23 @@ void FunctionStaticSlicer::computeRC() {
  * * SC(j)={j| REF(j) \cap RC(i) \neq \emptyset}
  *
  */
-void FunctionStaticSlicer::computeSCi(const Instruction *i, const Instruction *j) {
-
-  InsInfo *insInfoi, *insInfoj;
-  ValSet::const_iterator I, E;
-  if (!forward) { // backward
-    insInfoi = getInsInfo(i);
-    insInfoj = getInsInfo(j);
-    I = insInfoi->DEF_begin();
-    E = insInfoi->DEF_end();
-  }
+void FunctionStaticSlicer::computeSCi(InsInfo *insInfoi, InsInfo *insInfoj) {
+  bool isect_nonempty;
+  if (!forward) // backward
+    isect_nonempty = insInfoi->DEF_bits().intersects(insInfoj->RC_bits());
   else {
-    insInfoj = getInsInfo(i);
-    insInfoi = getInsInfo(j);
-    I = insInfoi->REF_begin();
-    E = insInfoi->REF_end();
+    std::swap(insInfoi, insInfoj);
+    isect_nonempty = insInfoi->REF_bits().intersects(insInfoj->RC_bits());
   }
-
-  bool isect_nonempty = false;
-  for (; I != E && !isect_nonempty; I++) {
-    const Value *VALi = *I; //VALi could be DEF or REF
-    for (ValSet::const_iterator II = insInfoj->RC_begin(),
-        EE = insInfoj->RC_end(); II != EE; II++) {
-      if (sameValues(VALi, *II)) {
+  if (isect_nonempty) {
 #ifdef DEBUG_SC
-        errs() << "\tRC: ";
-        printVal(*II);
-        errs() << " is referenced by ";
-        i->print(errs());
-        errs() << "\n";
+    errs() << "\tRC of ";
+    insInfoj->getIns()->print(errs());
+    errs() << " is referenced by ";
+    insInfoi->getIns()->print(errs());
+    errs() << "\n";
 #endif
-        isect_nonempty = true;
-        insInfoi->deslice();
-        break;
-      }
-    }
+    insInfoi->deslice();
   }
 }
 
@@ -555,13 +580,25 @@ void FunctionStaticSlicer::computeSCi(const Instruction *i, const Instruction *j
  * Backward, Forward: iterate every instruction and its successors
  */
 void FunctionStaticSlicer::computeSC() {
-  for (inst_iterator I = inst_begin(fun), E = inst_end(fun); I != E; I++) {
-    const Instruction *i = &*I;
-    SuccList succList = getSuccList(i);
-    for (SuccList::const_iterator II = succList.begin(), EE = succList.end();
-        II != EE; II++)
-      computeSCi(i, *II);
-  }
+  for (unsigned i = 0, e = insInfos.size(); i < e; ++i)
+    for (EdgeList::const_iterator I = succs[i].begin(), E = succs[i].end();
+        I != E; ++I)
+      computeSCi(insInfos[i], insInfos[*I]);
+}
+
+/*
+ * The pass manager hands out the analysis of one function at a time and
+ * reuses it for the next one, so the frontiers are copied while the slicer
+ * still runs alone.
+ */
+void FunctionStaticSlicer::prepareSlice() {
+  if (prepared || forward)
+    return;
+  PostDominanceFrontier &PDF = MP->getAnalysis<PostDominanceFrontier>(fun);
+  for (PostDominanceFrontier::const_iterator I = PDF.begin(), E = PDF.end();
+      I != E; ++I)
+    frontiers[I->first].append(I->second.begin(), I->second.end());
+  prepared = true;
 }
 
 /*
@@ -574,7 +611,7 @@ bool FunctionStaticSlicer::computeBC() {
   errs() << " ====== BEG BC Computation ======\n";
 #endif
   if (!forward) {
-    PostDominanceFrontier &PDF = MP->getAnalysis<PostDominanceFrontier>(fun);
+    prepareSlice();
     for (inst_iterator I = inst_begin(fun), E = inst_end(fun); I != E; I++) {
       Instruction *i = &*I;
       const InsInfo *ii = getInsInfo(i);
@@ -586,8 +623,8 @@ bool FunctionStaticSlicer::computeBC() {
       i->print(errs());
       errs() << " -> bb=" << BB->getName() << '\n';
 #endif
-      PostDominanceFrontier::const_iterator frontier = PDF.find(BB);
-      if (frontier == PDF.end())
+      Frontiers::const_iterator frontier = frontiers.find(BB);
+      if (frontier == frontiers.end())
         continue;
       changed |= updateRCSC(frontier->second.begin(), frontier->second.end());
     }
@@ -612,17 +649,7 @@ bool FunctionStaticSlicer::computeBC() {
         for (BasicBlock::iterator BI = BB->begin(), BE = BB->end(); BI != BE; BI++) {
           InsInfo *bii = getInsInfo(&*BI);
           bii->deslice();
-          for (ValSet::const_iterator VI = bii->DEF_begin(), VE = bii->DEF_end();
-            VI != VE; VI++) {
-            if (bii->addRC(*VI)) {
-              changed = true;
-#ifdef DEBUG_RC
-              errs() << "  added ";
-              printVal(*VI); 
-              errs() << "\n";
-#endif
-            }
-          }
+          changed |= bii->mergeRC(bii->DEF_bits());
         }
       }
     }
@@ -633,9 +660,8 @@ bool FunctionStaticSlicer::computeBC() {
   return changed;
 }
 
-bool FunctionStaticSlicer::updateRCSC(
-    PostDominanceFrontier::DomSetType::const_iterator start,
-    PostDominanceFrontier::DomSetType::const_iterator end) {
+bool FunctionStaticSlicer::updateRCSC(BlockList::const_iterator start,
+    BlockList::const_iterator end) {
   bool changed = false;
 #ifdef DEBUG_RC
   errs() << __func__ << " ============ BEG\n";
@@ -652,14 +678,7 @@ bool FunctionStaticSlicer::updateRCSC(
 #endif
     ii->deslice();
     /* RC = ... \cup \cup(b \in BC) RB */
-    for (ValSet::const_iterator II = ii->REF_begin(), EE = ii->REF_end();
-        II != EE; II++)
-      if (ii->addRC(*II)) {
-        changed = true;
-#ifdef DEBUG_RC
-        errs() << "  added " << (*II)->getName() << "\n";
-#endif
-      }
+    changed |= ii->mergeRC(ii->REF_bits());
   }
 #ifdef DEBUG_RC
   errs() << __func__ << " ============ END: changed=" << changed << "\n";
@@ -785,9 +804,9 @@ bool FunctionStaticSlicer::slice() {
   bool removed = false;
   for (inst_iterator I = inst_begin(fun), E = inst_end(fun); I != E;) {
     Instruction &i = *I;
-    InsInfoMap::iterator ii_iter = insInfoMap.find(&i);
-    assert(ii_iter != insInfoMap.end());
-    const InsInfo *ii = ii_iter->second;
+    InsIndexMap::iterator ii_iter = insIndex.find(&i);
+    assert(ii_iter != insIndex.end());
+    const InsInfo *ii = insInfos[ii_iter->second];
     ++I;
     if (ii->isSliced() && canSlice(i)) {
 #ifdef DEBUG_SLICE
@@ -797,7 +816,8 @@ bool FunctionStaticSlicer::slice() {
 #endif
       i.replaceAllUsesWith(UndefValue::get(i.getType()));
       i.eraseFromParent();
-      insInfoMap.erase(ii_iter);
+      insInfos[ii_iter->second] = NULL;
+      insIndex.erase(ii_iter);
       delete ii;
 
       removed = true;
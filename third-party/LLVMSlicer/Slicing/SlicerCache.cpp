@@ -0,0 +1,286 @@
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "llvm/Constants.h"
+#include "llvm/Instructions.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "llvmslicer/SlicerCache.h"
+
+using namespace llvm;
+
+#define CACHE_MAGIC 0x43435350U  // "PSCC"
+#define CACHE_VERSION 1
+
+namespace {
+
+  /// Hashes whatever is written to it with 64-bit FNV-1a, so the bitcode
+  /// never needs to be held in memory.
+  class HashStream : public raw_ostream {
+    public:
+      HashStream() : hash(14695981039346656037ULL), pos(0) {}
+      ~HashStream() { flush(); }
+
+      uint64_t getHash() { flush(); return hash; }
+
+    private:
+      virtual void write_impl(const char *Ptr, size_t Size) {
+        for (size_t i = 0; i < Size; ++i)
+          hash = (hash ^ (unsigned char) Ptr[i]) * 1099511628211ULL;
+        pos += Size;
+      }
+      virtual uint64_t current_pos() const { return pos; }
+
+      uint64_t hash;
+      uint64_t pos;
+  };
+
+  /// Bounds-checked reader over the mapped words
+  struct WordReader {
+    const uint32_t *cur;
+    const uint32_t *end;
+
+    WordReader(const uint32_t *b, const uint32_t *e) : cur(b), end(e) {}
+
+    bool read(uint32_t &w) {
+      if (cur == end)
+        return false;
+      w = *cur++;
+      return true;
+    }
+  };
+
+}
+
+namespace llvm { namespace slicing {
+
+  SlicerCache::SlicerCache(Module &M, const char *dir, unsigned mode) :
+    m_module(M), m_mode(mode), m_hash(0)
+  {
+    HashStream hs;
+    WriteBitcodeToFile(&M, hs);
+    m_hash = hs.getHash();
+
+    char name[64];
+    snprintf(name, sizeof(name), "/%016llx-%u.slc",
+        (unsigned long long) m_hash, mode);
+    m_path = std::string(dir) + name;
+
+    // the walk only depends on the module, hence on the bitcode
+    for (Module::global_iterator G = M.global_begin(), E = M.global_end();
+        G != E; ++G) {
+      number(G);
+      if (G->hasInitializer())
+        numberConstant(G->getInitializer());
+    }
+    for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F) {
+      number(F);
+      for (Function::arg_iterator A = F->arg_begin(), AE = F->arg_end();
+          A != AE; ++A)
+        number(A);
+      for (Function::iterator B = F->begin(), BE = F->end(); B != BE; ++B) {
+        number(B);
+        for (BasicBlock::iterator I = B->begin(), IE = B->end(); I != IE; ++I) {
+          number(I);
+          for (User::op_iterator O = I->op_begin(), OE = I->op_end();
+              O != OE; ++O)
+            if (const Constant *C = dyn_cast<Constant>(*O))
+              numberConstant(C);
+        }
+      }
+    }
+  }
+
+  void SlicerCache::number(const Value *V)
+  {
+    if (m_ids.count(V))
+      return;
+    m_ids[V] = m_values.size();
+    m_values.push_back(V);
+  }
+
+  /// Constants are numbered with their operands, since constant
+  /// expressions and null pointers can show up in the points-to sets.
+  void SlicerCache::numberConstant(const Constant *C)
+  {
+    if (isa<GlobalValue>(C) || m_ids.count(C))
+      return;
+    number(C);
+    for (User::const_op_iterator O = C->op_begin(), OE = C->op_end();
+        O != OE; ++O)
+      if (const Constant *OC = dyn_cast<Constant>(*O))
+        numberConstant(OC);
+  }
+
+  bool SlicerCache::getId(const Value *V, uint32_t &id) const
+  {
+    DenseMap<const Value *, uint32_t>::const_iterator it = m_ids.find(V);
+    if (it == m_ids.end())
+      return false;
+    id = it->second;
+    return true;
+  }
+
+  bool SlicerCache::load(ptr::PointsToSets &PS, mods::Modifies &MOD,
+      CallEdges &calls)
+  {
+    int fd = open(m_path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 6 * (off_t) sizeof(uint32_t)) {
+      close(fd);
+      return false;
+    }
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+      return false;
+
+    const uint32_t *words = (const uint32_t *) addr;
+    WordReader R(words, words + st.st_size / sizeof(uint32_t));
+    uint32_t magic, version, mode, nvalues, lo, hi;
+    bool ok = R.read(magic) && R.read(version) && R.read(mode) &&
+      R.read(nvalues) && R.read(lo) && R.read(hi) &&
+      magic == CACHE_MAGIC && version == CACHE_VERSION && mode == m_mode &&
+      nvalues == m_values.size() &&
+      (((uint64_t) hi << 32) | lo) == m_hash;
+
+    // points-to sets
+    uint32_t n, key, count, id, id2;
+    if (ok)
+      ok = R.read(n);
+    for (uint32_t i = 0; ok && i < n; ++i) {
+      ok = R.read(key) && R.read(count) && key < nvalues;
+      if (!ok)
+        break;
+      ptr::PointsToSets::PointsToSet &S = PS[m_values[key]];
+      for (uint32_t j = 0; ok && j < count; ++j) {
+        ok = R.read(id) && id < nvalues;
+        if (ok)
+          S.insert(S.end(), m_values[id]);
+      }
+    }
+    // mod sets
+    if (ok)
+      ok = R.read(n);
+    for (uint32_t i = 0; ok && i < n; ++i) {
+      ok = R.read(key) && R.read(count) && key < nvalues &&
+        isa<Function>(m_values[key]);
+      if (!ok)
+        break;
+      mods::Modifies::ModSet &S = MOD[cast<Function>(m_values[key])];
+      for (uint32_t j = 0; ok && j < count; ++j) {
+        ok = R.read(id) && id < nvalues;
+        if (ok)
+          S.insert(S.end(), m_values[id]);
+      }
+    }
+    // call edges
+    if (ok)
+      ok = R.read(n);
+    for (uint32_t i = 0; ok && i < n; ++i) {
+      ok = R.read(id) && R.read(id2) && id < nvalues && id2 < nvalues &&
+        isa<CallInst>(m_values[id]) && isa<Function>(m_values[id2]);
+      if (ok)
+        calls.insert(std::make_pair(cast<CallInst>(m_values[id]),
+              cast<Function>(m_values[id2])));
+    }
+    munmap(addr, st.st_size);
+
+    if (!ok) {
+      errs() << "Ignoring corrupted slicer cache " << m_path << "\n";
+      PS.getContainer().clear();
+      MOD.getContainer().clear();
+      calls.clear();
+    }
+    return ok;
+  }
+
+  bool SlicerCache::save(const ptr::PointsToSets &PS,
+      const mods::Modifies &MOD, const CallEdges &calls)
+  {
+    std::vector<uint32_t> words;
+    uint32_t id;
+    words.push_back(CACHE_MAGIC);
+    words.push_back(CACHE_VERSION);
+    words.push_back(m_mode);
+    words.push_back(m_values.size());
+    words.push_back((uint32_t) m_hash);
+    words.push_back((uint32_t) (m_hash >> 32));
+
+    // a value outside of the walk could not be mapped back, so rather
+    // than caching a partial result nothing is cached
+    words.push_back(PS.getContainer().size());
+    for (ptr::PointsToSets::const_iterator I = PS.begin(), E = PS.end();
+        I != E; ++I) {
+      if (!getId(I->first, id))
+        return false;
+      words.push_back(id);
+      words.push_back(I->second.size());
+      for (ptr::PointsToSets::PointsToSet::const_iterator SI =
+          I->second.begin(), SE = I->second.end(); SI != SE; ++SI) {
+        if (!getId(*SI, id))
+          return false;
+        words.push_back(id);
+      }
+    }
+    words.push_back(MOD.getContainer().size());
+    for (mods::Modifies::const_iterator I = MOD.begin(), E = MOD.end();
+        I != E; ++I) {
+      if (!getId(I->first, id))
+        return false;
+      words.push_back(id);
+      words.push_back(I->second.size());
+      for (mods::Modifies::ModSet::const_iterator SI = I->second.begin(),
+          SE = I->second.end(); SI != SE; ++SI) {
+        if (!getId(*SI, id))
+          return false;
+        words.push_back(id);
+      }
+    }
+    words.push_back(calls.size());
+    for (CallEdges::const_iterator I = calls.begin(), E = calls.end();
+        I != E; ++I) {
+      if (!getId(I->first, id))
+        return false;
+      words.push_back(id);
+      if (!getId(I->second, id))
+        return false;
+      words.push_back(id);
+    }
+
+    // written aside and renamed, so readers never see half a file; the
+    // temporary name is unique so that concurrent runs don't share it
+    std::vector<char> tmp(m_path.begin(), m_path.end());
+    const char suffix[] = ".XXXXXX";
+    tmp.insert(tmp.end(), suffix, suffix + sizeof(suffix));
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0)
+      return false;
+    fchmod(fd, 0644);
+    FILE *fp = fdopen(fd, "wb");
+    if (fp == NULL) {
+      close(fd);
+      unlink(&tmp[0]);
+      return false;
+    }
+    bool ok = fwrite(&words[0], sizeof(uint32_t), words.size(), fp) ==
+      words.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(&tmp[0], m_path.c_str()) != 0) {
+      unlink(&tmp[0]);
+      return false;
+    }
+    return true;
+  }
+
+}}
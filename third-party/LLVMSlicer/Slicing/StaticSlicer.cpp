@@ -1,6 +1,8 @@
 // This file is distributed under the University of Illinois Open Source
 // License. See LICENSE.TXT for details.
 
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/time.h>
 
 #include "llvm/LLVMContext.h"
@@ -10,11 +12,13 @@
 #include "llvm/Pass.h"
 #include "llvm/Value.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Threading.h"
 
 #include "commons/handy.h"
 #include "llvmslicer/Callgraph.h"
 #include "llvmslicer/Modifies.h"
 #include "llvmslicer/PointsTo.h"
+#include "llvmslicer/SlicerCache.h"
 #include "llvmslicer/StaticSlicer.h"
 #include "mapper/Matcher.h"
 
@@ -56,23 +60,33 @@ namespace llvm { namespace slicing { namespace detail {
 
 }}}
 
-namespace llvm {namespace slicing {
+namespace {
+
+  /// Function slicers of a wave, handed out to the worker threads
+  struct WaveJobs {
+    std::vector<llvm::slicing::FunctionStaticSlicer *> slicers;
+    unsigned next;
+    pthread_mutex_t lock;
+  };
 
-  static bool setAdd(WorkList &list, const Function * elem)
+  void *sliceWorker(void *arg)
   {
-    bool included = false;
-    for (WorkList::iterator WI = list.begin(), WE = list.end(); WI != WE; ++WI) {
-      if (*WI == elem) {
-        included = true;
+    WaveJobs *jobs = static_cast<WaveJobs *>(arg);
+    while (true) {
+      pthread_mutex_lock(&jobs->lock);
+      unsigned i = jobs->next++;
+      pthread_mutex_unlock(&jobs->lock);
+      if (i >= jobs->slicers.size())
         break;
-      }
+      jobs->slicers[i]->calculateStaticSlice();
     }
-    if (!included) {
-      list.push_back(elem);
-    }
-    return !included;
+    return NULL;
   }
 
+}
+
+namespace llvm {namespace slicing {
+
   void StaticSlicer::buildDicts(const ptr::PointsToSets &PS)
   {
     typedef Module::iterator FunctionsIter;
@@ -102,40 +116,33 @@ namespace llvm {namespace slicing {
           }
   }
 
-  StaticSlicer::StaticSlicer(bool forward, bool sound) : ModulePass(ID), m_module(NULL), 
+  StaticSlicer::StaticSlicer(bool forward, PointsToMode mode) : ModulePass(ID), m_module(NULL), 
     m_forward(forward), m_slicers(), m_initFuns(), m_funcsToCalls(), 
-    m_callsToFuncs(), m_ps(NULL), m_cg(NULL), m_mod(NULL), m_criteriaInit(false) 
+    m_callsToFuncs(), m_ps(NULL), m_cg(NULL), m_mod(NULL), m_criteriaInit(false),
+    m_cachedir(NULL), m_summaryEdges(false), m_deadline(0), m_partial(false)
   {
-    m_sound = sound;
+    m_ptmode = mode;
     m_instInit = false;
     m_funcInit = false;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    m_threads = cpus > 0 ? cpus : 1;
   }
   
-  bool StaticSlicer::runOnModule(Module &M) {
+  /// Computes the points-to sets, the mod sets and the call dictionaries
+  void StaticSlicer::buildModuleInfo(Module &M) {
     struct timeval atim;
     double at1,at2;
 
-    errs() << "Building Default CallGraph...\n";
-    gettimeofday(&atim, NULL);
-    at1 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
-
-    CallGraph * tcg = &getAnalysis<CallGraph>();
-
-    gettimeofday(&atim, NULL);
-    at2 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
-    fprintf(stderr, "%.4f ms\n", at2-at1);
-
-    m_module = &M;
     gettimeofday(&atim, NULL);
     at1 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
-    m_ps = new ptr::PointsToSets();
     {
-      if (m_sound) {
+      if (m_ptmode != PTM_NONE) {
 #ifdef DEBUG_STATIC_SLICER
         errs() << "Computing PointsToSet...\n";
 #endif
         ptr::ProgramStructure P(M);
-        computePointsToSets(P, *m_ps);
+        computePointsToSets(P, *m_ps, m_ptmode == PTM_UNIFICATION ?
+            ptr::PTS_UNIFICATION : ptr::PTS_WORKLIST);
       }
       else {
 #ifdef DEBUG_STATIC_SLICER
@@ -162,7 +169,6 @@ namespace llvm {namespace slicing {
 #endif
     gettimeofday(&atim, NULL);
     at1 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
-    m_mod = new mods::Modifies();
     {
       mods::ProgramStructure P1(M);
       computeModifies(P1, *m_cg, *m_ps, *m_mod);
@@ -178,22 +184,51 @@ namespace llvm {namespace slicing {
     buildDicts(*m_ps);
     at2 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
     fprintf(stderr, "%.4f ms\n", at2-at1);
+  }
 
-#ifdef DEBUG_STATIC_SLICER
-    errs() << "Building FSS...\n";
-#endif
+  bool StaticSlicer::runOnModule(Module &M) {
+    struct timeval atim;
+    double at1,at2;
+
+    errs() << "Building Default CallGraph...\n";
     gettimeofday(&atim, NULL);
     at1 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
-    for (Module::iterator MI = M.begin(), ME = M.end(); MI != ME; ++MI) {
-      Function * f = MI;
-      if (f->isIntrinsic())
-        continue;
-      // errs() << "\t|" << f << "@" << f->getName() << "|\n";
-      newFSS(f);
-    }
+
+    CallGraph * tcg = &getAnalysis<CallGraph>();
+
+    gettimeofday(&atim, NULL);
     at2 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
     fprintf(stderr, "%.4f ms\n", at2-at1);
 
+    m_module = &M;
+    m_ps = new ptr::PointsToSets();
+    m_mod = new mods::Modifies();
+    if (m_cachedir) {
+      gettimeofday(&atim, NULL);
+      at1 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
+      SlicerCache cache(M, m_cachedir, m_ptmode);
+      bool cached = cache.load(*m_ps, *m_mod, m_callsToFuncs);
+      gettimeofday(&atim, NULL);
+      at2 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
+      fprintf(stderr, "%.4f ms\n", at2-at1);
+      if (cached) {
+#ifdef DEBUG_STATIC_SLICER
+        errs() << "Loaded slicer cache " << cache.getPath() << "\n";
+#endif
+        for (CallsToFuncs::const_iterator I = m_callsToFuncs.begin(),
+            E = m_callsToFuncs.end(); I != E; ++I)
+          m_funcsToCalls.insert(std::make_pair(I->second, I->first));
+      } else {
+        buildModuleInfo(M);
+        if (!cache.save(*m_ps, *m_mod, m_callsToFuncs))
+          errs() << "Cannot write slicer cache " << cache.getPath() << "\n";
+      }
+    } else {
+      buildModuleInfo(M);
+    }
+
+    // function slicers are built on demand by getFSS
+
 #ifdef DEBUG_STATIC_SLICER
     errs() << "Initialized.\n";
 #endif
@@ -217,20 +252,40 @@ namespace llvm {namespace slicing {
 
   FunctionStaticSlicer * StaticSlicer::newFSS(Function * F) {
     FunctionStaticSlicer *FSS = new FunctionStaticSlicer(*F, this, *m_ps, *m_mod, m_forward);
+    if (m_summaryEdges)
+      FSS->setSummaries(&m_callSummaries);
     m_slicers.insert(Slicers::value_type(F, FSS));
     return FSS;
   }
 
+  /// Creates the slicer of a function the first time the slice reaches it,
+  /// most functions of the module are never reached.
   FunctionStaticSlicer * StaticSlicer::getFSS(const Function * F) {
     Slicers::iterator si;
     si = m_slicers.find(F);
     if (si == m_slicers.end()) {
-      errs() << "No slicer for " << F << "@" << F->getName() << "\n";
-      return NULL;
+      if (F->isIntrinsic()) {
+        errs() << "No slicer for " << F << "@" << F->getName() << "\n";
+        return NULL;
+      }
+      return newFSS(const_cast<Function *>(F));
     }
-    // assert(si != m_slicers.end());
     return si->second;
   }
+
+  /// Frees the function slicers once the slice has been consumed, so the
+  /// next criteria start from a clean state.
+  void StaticSlicer::releaseSlice() {
+    for (Slicers::const_iterator I = m_slicers.begin(), E = m_slicers.end();
+        I != E; ++I)
+      delete I->second;
+    m_slicers.clear();
+    m_initFuns.clear();
+    m_sliceFuncs.clear();
+    m_criteriaInit = false;
+    m_funcInit = false;
+    m_instInit = false;
+  }
   
   void StaticSlicer::addInitRC(FunctionStaticSlicer * FSS, const Instruction *inst)
   {
@@ -252,11 +307,162 @@ namespace llvm {namespace slicing {
         }
         if (LHS) {
           FSS->addInitialCriterion(inst, LHS);
+        } else if (InsInfo * insInfo = FSS->getInsInfo(inst)) {
+          // e.g., a branch, whose condition is what matters
+          ValSet::const_iterator ci, ce;
+          for (ci = insInfo->REF_begin(), ce = insInfo->REF_end(); ci != ce; ci++)
+            FSS->addInitialCriterion(inst, *ci);
+        }
+      }
+  }
+
+  /// Slices the functions of a wave. They only read their own slicer, so
+  /// they are sliced concurrently; the slicers are created and fed their
+  /// analyses beforehand, as neither is thread-safe.
+  void StaticSlicer::sliceWave(const FuncSet &wave) {
+    WaveJobs jobs;
+    for (FuncSet::const_iterator WI = wave.begin(), WE = wave.end();
+        WI != WE; ++WI) {
+      if ((*WI)->isIntrinsic()) // skip intrinsic
+        continue;
+      FunctionStaticSlicer *fss = getFSS(*WI);
+      fss->prepareSlice();
+      if (m_summaryEdges)
+        summarizeCalls(*WI);
+      jobs.slicers.push_back(fss);
+    }
+    unsigned nthreads = std::min<unsigned>(m_threads, jobs.slicers.size());
+    if (nthreads <= 1) {
+      for (unsigned i = 0; i < jobs.slicers.size(); ++i)
+        jobs.slicers[i]->calculateStaticSlice();
+      return;
+    }
+    jobs.next = 0;
+    pthread_mutex_init(&jobs.lock, NULL);
+    if (!llvm_is_multithreaded())
+      llvm_start_multithreaded();
+    std::vector<pthread_t> threads(nthreads);
+    unsigned started = 0;
+    for (; started < nthreads; ++started)
+      if (pthread_create(&threads[started], NULL, sliceWorker, &jobs) != 0)
+        break;
+    // whatever the workers did not take is sliced here
+    sliceWorker(&jobs);
+    for (unsigned i = 0; i < started; ++i)
+      pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&jobs.lock);
+  }
+
+  /// Summary of a function: what the forward slice of each parameter
+  /// reaches at its exits. NULL for declarations and for functions still
+  /// being summarized up the stack, whose recursive calls keep the plain
+  /// rule.
+  const CallSummary * StaticSlicer::summarize(const Function *F) {
+    if (F->isDeclaration() || F->isIntrinsic())
+      return NULL;
+    FuncSummaries::const_iterator it = m_funcSummaries.find(F);
+    if (it != m_funcSummaries.end())
+      return &it->second;
+    if (!m_summarizing.insert(F).second)
+      return NULL;
+    summarizeCalls(F);
+
+    CallSummary S(F->arg_size());
+    typedef std::vector<const llvm::ReturnInst *> ExitsVec;
+    ExitsVec E;
+    getFunctionExits(F, std::back_inserter(E));
+    unsigned k = 0;
+    for (Function::const_arg_iterator A = F->arg_begin(), AE = F->arg_end();
+        A != AE; ++A, ++k) {
+      FunctionStaticSlicer fss(*const_cast<Function *>(F), this, *m_ps,
+          *m_mod, true);
+      fss.setSummaries(&m_callSummaries);
+      const Value *param = &*A;
+      fss.addCriterion(getFunctionEntry(F), &param, &param + 1);
+      fss.calculateStaticSlice();
+      for (ExitsVec::const_iterator ei = E.begin(); ei != E.end(); ++ei) {
+        const Value *ret = (*ei)->getReturnValue();
+        if (!fss.isSliced(*ei) || (ret && std::find(fss.relevant_begin(*ei),
+                fss.relevant_end(*ei), ret) != fss.relevant_end(*ei)))
+          S[k].returns = true;
+      }
+      for (const_inst_iterator I = inst_begin(F), IE = inst_end(F); I != IE;
+          ++I) {
+        if (fss.isSliced(&*I))
+          continue;
+        for (ValSet::const_iterator V = fss.DEF_begin(&*I),
+            VE = fss.DEF_end(&*I); V != VE; ++V)
+          if (!isa<Argument>(*V) && !isLocalToFunction(*V, F))
+            S[k].mods.insert(*V);
+      }
+    }
+    m_summarizing.erase(F);
+#ifdef DEBUG_SLICER
+    errs() << "summarized " << F->getName() << "\n";
+#endif
+    return &(m_funcSummaries[F] = S);
+  }
+
+  /// Summary edges of the call sites of F, the union of the summaries of
+  /// their possible callees. Calls with a callee that cannot be summarized
+  /// get none.
+  void StaticSlicer::summarizeCalls(const Function *F) {
+    typedef std::vector<const llvm::CallInst *> CallsVec;
+    CallsVec C;
+    getFunctionCalls(F, std::back_inserter(C));
+    for (CallsVec::const_iterator c = C.begin(); c != C.end(); ++c) {
+      if (m_callSummaries.count(*c))
+        continue;
+      CallsToFuncs::const_iterator g, e;
+      llvm::tie(g, e) = m_callsToFuncs.equal_range(*c);
+      if (g == e)
+        continue;
+      CallSummary CS;
+      bool complete = true;
+      for ( ; g != e && complete; ++g) {
+        const CallSummary *S = summarize(g->second);
+        if (S == NULL) {
+          complete = false;
+          break;
+        }
+        if (CS.size() < S->size())
+          CS.resize(S->size());
+        for (unsigned k = 0; k < S->size(); ++k) {
+          CS[k].returns |= (*S)[k].returns;
+          CS[k].mods.insert((*S)[k].mods.begin(), (*S)[k].mods.end());
         }
       }
+      if (complete)
+        m_callSummaries[*c] = CS;
+    }
+  }
+
+  /// Backward: to the callers, Forward: to the callers from the returns
+  void StaticSlicer::emitUp(const Function *F, FuncSet &out) {
+    if (!m_forward)
+      emitToCalls(F, std::back_inserter(out));
+    else
+      emitToForwardCalls(F, std::back_inserter(out));
+  }
+
+  /// Backward: to the callees from the returns, Forward: to the callees
+  void StaticSlicer::emitDown(const Function *F, FuncSet &out) {
+    if (!m_forward)
+      emitToExits(F, std::back_inserter(out));
+    else
+      emitToForwardExits(F, std::back_inserter(out));
+  }
+
+  bool StaticSlicer::pastDeadline() const {
+    if (m_deadline <= 0)
+      return false;
+    struct timeval tim;
+    gettimeofday(&tim, NULL);
+    return tim.tv_sec * 1000.0 + (tim.tv_usec/1000.0) > m_deadline;
   }
 
   void StaticSlicer::computeSlice() {
+    m_partial = false;
     if (!m_criteriaInit) {
       errs() << "No criteria is added to the slicer, call addCriteria\n";
       return;
@@ -270,36 +476,40 @@ namespace llvm {namespace slicing {
     gettimeofday(&atim, NULL);
     double at1 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
 
-    WorkList Q(m_initFuns);
-    WorkList P;
+    FuncSet Q;
+    std::copy(m_initFuns.begin(), m_initFuns.end(), std::back_inserter(Q));
+    FuncSet P;
 
     // Backward:  DOWN*(UP*({C}))
     // Forward:   UP*(DOWN*({C}))
+    //
+    // With summary edges, the calls are crossed by their summaries, so a
+    // forward slice ascends first as well, DOWN*(UP*({C})). Ascending
+    // from the callees it descended to would mix the calling contexts.
+    bool upFirst = !m_forward || m_summaryEdges;
 
     // Phase 1
     //   Backward:  UP*({C})
     //   Forward:   DOWN*({C})
 
-    while (!Q.empty()) {
-      for (WorkList::iterator WI = Q.begin(), WE = Q.end(); WI != WE; ++WI) {
+    // past the deadline, the slice is left to the functions already in it
+    while (!Q.empty() && !(m_partial = pastDeadline())) {
+      sliceWave(Q);
+      for (FuncSet::const_iterator WI = Q.begin(), WE = Q.end(); WI != WE; ++WI) {
         const Function * F = *WI;
         if (F->isIntrinsic()) // skip intrinsic
           continue;
-        FunctionStaticSlicer *fss = getFSS(F);
-        fss->calculateStaticSlice();
-        if (setAdd(P, F)) {
-          m_sliceFuncs.push_back(F);
-        }
+        if (P.insert(F))
+          m_sliceFuncs.insert(F);
       }
-      WorkList tmp;
-      for (WorkList::iterator WI = Q.begin(), WE = Q.end(); WI != WE; ++WI) {
-        const Function * F = *WI;
-        if (!m_forward)
-          emitToCalls(F, std::inserter(tmp, tmp.end()));
+      FuncSet tmp;
+      for (FuncSet::const_iterator WI = Q.begin(), WE = Q.end(); WI != WE; ++WI) {
+        if (upFirst)
+          emitUp(*WI, tmp);
         else
-          emitToForwardExits(F, std::inserter(tmp, tmp.end()));
+          emitDown(*WI, tmp);
       }
-      std::swap(tmp,Q);
+      Q.swap(tmp);
     }
     gettimeofday(&atim, NULL);
     double at2 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
@@ -311,31 +521,26 @@ namespace llvm {namespace slicing {
     // Phase 2
     //     Backward: DOWN*(XXX)
     //     Forward:  UP*(XXX)
-    while (!P.empty()) {
-      for (WorkList::iterator WI = P.begin(), WE = P.end(); WI != WE; ++WI) {
-        const Function * F = *WI;
-        if (F->isIntrinsic()) // skip intrinsic
-          continue;
-        FunctionStaticSlicer *fss = getFSS(F);
-        fss->calculateStaticSlice();
-        setAdd(m_sliceFuncs, F);
-      }
-      WorkList tmp;
-      for (WorkList::iterator WI = P.begin(), WE = P.end(); WI != WE; ++WI) {
-        const Function * F = *WI;
-        if (!m_forward)
-          emitToExits(F, std::inserter(tmp, tmp.end()));
+    while (!P.empty() && !(m_partial = pastDeadline())) {
+      sliceWave(P);
+      for (FuncSet::const_iterator WI = P.begin(), WE = P.end(); WI != WE; ++WI)
+        if (!(*WI)->isIntrinsic())
+          m_sliceFuncs.insert(*WI);
+      FuncSet tmp;
+      for (FuncSet::const_iterator WI = P.begin(), WE = P.end(); WI != WE; ++WI) {
+        if (upFirst)
+          emitDown(*WI, tmp);
         else
-          emitToForwardCalls(F, std::inserter(tmp, tmp.end()));
+          emitUp(*WI, tmp);
       }
-      std::swap(tmp,P);
+      P.swap(tmp);
     }
     gettimeofday(&atim, NULL);
     at2 = atim.tv_sec * 1000.0 + (atim.tv_usec/1000.0);
     fprintf(stderr, "%.4f ms\n", at2-at1);
 #ifdef DEBUG_STATIC_SLICER
 //    errs() << "sliced functions:\n";
-//    for (FuncIter fi = m_sliceFuncs.begin(), fe = m_sliceFuncs.end(); fi != fe; ++fi) {
+//    for (FuncSet::const_iterator fi = m_sliceFuncs.begin(), fe = m_sliceFuncs.end(); fi != fe; ++fi) {
 //      errs() << cpp_demangle((*fi)->getName().data()) << "\n";
 //      getFSS(*fi)->dump(true);
 //    }
@@ -365,6 +570,7 @@ namespace llvm {namespace slicing {
       }
       m_instInit = false;
     }
+    releaseSlice();
     return NULL;
   }
 
@@ -0,0 +1,569 @@
+/**
+ *  @file          CostCalibrator.cpp
+ *
+ *  @version       1.0
+ *  @created       03/02/2013 03:12:47 PM
+ *  @revision      $Id$
+ *
+ *  @author        Ryan Huang <ryanhuang@cs.ucsd.edu>
+ *  @organization  University of California, San Diego
+ *  
+ *  Copyright (c) 2013, Ryan Huang
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *     
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  @section       DESCRIPTION
+ *  
+ *  Calibrate the instruction costs of the cost model by timing
+ *  JIT-compiled microkernels on the local machine
+ *
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "llvm/LLVMContext.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/Type.h"
+
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/JIT.h"
+
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetLowering.h"
+
+#include "llvm/Support/Host.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "commons/handy.h"
+#include "commons/LLVMHelper.h"
+#include "analyzer/CalibratedCostTable.h"
+#include "analyzer/TargetTransformStub.h"
+
+using namespace std;
+using namespace llvm;
+
+static char * program_name;
+
+#define KERNEL_UNROLL 8 // number of measured operations per loop iteration
+#define KERNEL_ITERS (1 << 20)
+#define KERNEL_RUNS 21
+#define KERNEL_WARMUPS 3
+#define KERNEL_SLOT 32 // one input operand of up to 256 bits
+#define KERNEL_BUFSIZE 256 // three input slots plus room for the output
+
+static unsigned iterations = KERNEL_ITERS;
+static unsigned runs = KERNEL_RUNS;
+static bool verbose = false;
+
+static raw_ostream * fout = NULL;
+
+typedef void (*KernelFn)(uint64_t, void *, void *);
+
+/// The shape of the IR generated for an opcode.
+///
+/// Chain:  acc = op acc, b                 (binary operators)
+/// Div:    acc = op (acc | a), b           (div, rem; '+' for FP)
+/// Cast:   store (cast (load in)), out     (conversions)
+/// Cmp:    store (cmp (load a), (load b))  (icmp, fcmp)
+/// Select: store (select (load c), (load a), (load b)), out
+/// Load:   load in
+/// Store:  store 0, out
+///
+/// Every kernel has a baseline twin in which the measured operation
+/// is removed but the memory traffic and the loop are kept.
+enum KernelShape { ChainShape, CastShape, CmpShape, SelectShape, LoadShape, StoreShape };
+
+struct KernelSpec {
+  unsigned Opcode;
+  KernelShape Shape;
+  Type * Dst;
+  Type * Src;
+  KernelSpec(unsigned Op, KernelShape S, Type * D, Type * Sr = NULL) :
+    Opcode(Op), Shape(S), Dst(D), Src(Sr) {}
+};
+
+static bool isDivRem(unsigned Opcode)
+{
+  switch (Opcode) {
+    case Instruction::UDiv: case Instruction::SDiv:
+    case Instruction::URem: case Instruction::SRem:
+    case Instruction::FDiv: case Instruction::FRem:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static double now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// Median of the samples after rejecting the outliers outside
+/// of [Q1 - 1.5 IQR, Q3 + 1.5 IQR].
+static double robust_median(vector<double> & samples)
+{
+  assert(!samples.empty() && "no samples");
+  sort(samples.begin(), samples.end());
+  size_t n = samples.size();
+  double q1 = samples[n / 4];
+  double q3 = samples[(3 * n) / 4];
+  double iqr = q3 - q1;
+  vector<double> kept;
+  for (size_t i = 0; i < n; ++i) {
+    if (samples[i] >= q1 - 1.5 * iqr && samples[i] <= q3 + 1.5 * iqr)
+      kept.push_back(samples[i]);
+  }
+  if (kept.empty())
+    return samples[n / 2];
+  return kept[kept.size() / 2];
+}
+
+static Value * emitOp(IRBuilder<> & B, const KernelSpec & spec, Value * A,
+    Value * Bv, Value * C)
+{
+  switch (spec.Shape) {
+    case ChainShape:
+      return B.CreateBinOp((Instruction::BinaryOps) spec.Opcode, A, Bv);
+    case CastShape:
+      return B.CreateCast((Instruction::CastOps) spec.Opcode, A, spec.Dst);
+    case CmpShape:
+      if (spec.Opcode == Instruction::ICmp)
+        return B.CreateICmpSLT(A, Bv);
+      return B.CreateFCmpOLT(A, Bv);
+    case SelectShape:
+      return B.CreateSelect(C, A, Bv);
+    default:
+      return NULL;
+  }
+}
+
+/// Generate 'void kernel(i64 n, i8* in, i8* out)' for the given spec.
+static Function * buildKernel(Module * M, const KernelSpec & spec, bool baseline)
+{
+  LLVMContext & C = M->getContext();
+  Type * I64 = Type::getInt64Ty(C);
+  Type * I8P = Type::getInt8PtrTy(C);
+  Type * Params[] = { I64, I8P, I8P };
+  FunctionType * FTy = FunctionType::get(Type::getVoidTy(C), Params, false);
+  Function * F = Function::Create(FTy, Function::ExternalLinkage,
+      baseline ? "baseline" : "kernel", M);
+  Function::arg_iterator AI = F->arg_begin();
+  Value * N = AI++;
+  Value * In = AI++;
+  Value * Out = AI++;
+
+  BasicBlock * Entry = BasicBlock::Create(C, "entry", F);
+  BasicBlock * Loop = BasicBlock::Create(C, "loop", F);
+  BasicBlock * Exit = BasicBlock::Create(C, "exit", F);
+
+  IRBuilder<> B(Entry);
+  Type * SrcTy = spec.Src ? spec.Src : spec.Dst;
+  Value * PIn = B.CreateBitCast(In, PointerType::getUnqual(SrcTy));
+  Value * POut = B.CreateBitCast(Out, PointerType::getUnqual(spec.Dst));
+  Value * PFlag = B.CreateBitCast(Out, PointerType::getUnqual(Type::getInt1Ty(C)));
+  // The select condition is an input of its own, apart from the output
+  Value * PCond = B.CreateBitCast(B.CreateConstGEP1_32(In, 2 * KERNEL_SLOT),
+      PointerType::getUnqual(Type::getInt1Ty(C)));
+  Value * PIn1 = B.CreateBitCast(B.CreateConstGEP1_32(In, KERNEL_SLOT),
+      PointerType::getUnqual(SrcTy));
+  Value * Init = NULL, * Operand = NULL;
+  if (spec.Shape == ChainShape) {
+    // Operands are loaded from memory so that they cannot be folded
+    Init = B.CreateLoad(PIn, true);
+    Operand = B.CreateLoad(PIn1, true);
+  }
+  B.CreateBr(Loop);
+
+  B.SetInsertPoint(Loop);
+  PHINode * Idx = B.CreatePHI(I64, 2);
+  Idx->addIncoming(ConstantInt::get(I64, 0), Entry);
+  PHINode * Acc = NULL;
+  Value * Cur = NULL;
+  if (spec.Shape == ChainShape) {
+    Acc = B.CreatePHI(spec.Dst, 2);
+    Acc->addIncoming(Init, Entry);
+    Cur = Acc;
+  }
+  for (unsigned k = 0; k < KERNEL_UNROLL; ++k) {
+    switch (spec.Shape) {
+      case ChainShape:
+        // Keep the dividend large so that the division never takes the
+        // early-out path for small operands; the baseline keeps it too
+        if (isDivRem(spec.Opcode))
+          Cur = spec.Dst->isFPOrFPVectorTy() ? B.CreateFAdd(Cur, Init) : 
+            B.CreateOr(Cur, Init);
+        if (!baseline)
+          Cur = emitOp(B, spec, Cur, Operand, NULL);
+        break;
+      case CastShape:
+      case CmpShape:
+      case SelectShape:
+      {
+        Value * A = B.CreateLoad(PIn, true);
+        Value * Bv = spec.Shape == CastShape ? NULL : B.CreateLoad(PIn1, true);
+        Value * Cond = spec.Shape == SelectShape ? B.CreateLoad(PCond, true) : NULL;
+        if (baseline) {
+          if (spec.Shape == CmpShape)
+            B.CreateStore(ConstantInt::getFalse(C), PFlag, true);
+          else
+            B.CreateStore(Constant::getNullValue(spec.Dst), POut, true);
+        }
+        else {
+          Value * R = emitOp(B, spec, A, Bv, Cond);
+          if (spec.Shape == CmpShape)
+            B.CreateStore(R, PFlag, true);
+          else
+            B.CreateStore(R, POut, true);
+        }
+        break;
+      }
+      case LoadShape:
+        if (!baseline)
+          B.CreateLoad(PIn, true);
+        break;
+      case StoreShape:
+        if (!baseline)
+          B.CreateStore(Constant::getNullValue(spec.Dst), POut, true);
+        break;
+    }
+  }
+  if (Acc)
+    Acc->addIncoming(Cur, Loop);
+  Value * Next = B.CreateAdd(Idx, ConstantInt::get(I64, 1));
+  Idx->addIncoming(Next, Loop);
+  B.CreateCondBr(B.CreateICmpULT(Next, N), Loop, Exit);
+
+  B.SetInsertPoint(Exit);
+  if (Acc)
+    B.CreateStore(Cur, POut, true);
+  B.CreateRetVoid();
+  return F;
+}
+
+/// Fill slot 0 of the input buffer with a large value and slot 1 with 1,
+/// or with 7 for division and remainder so that they do real work, and
+/// slot 2 with the condition of select kernels.
+static void fillBuffer(const KernelSpec & spec, char * buf)
+{
+  memset(buf, 0, KERNEL_BUFSIZE);
+  Type * Ty = spec.Src ? spec.Src : spec.Dst;
+  Type * Elem = Ty->getScalarType();
+  unsigned Lanes = Ty->isVectorTy() ? cast<VectorType>(Ty)->getNumElements() : 1;
+  unsigned Size = Elem->getPrimitiveSizeInBits() / 8;
+  if (Size == 0)
+    Size = 1;
+  int divisor = isDivRem(spec.Opcode) ? 7 : 1;
+  char * slot1 = buf + KERNEL_SLOT;
+  for (unsigned i = 0; i < Lanes; ++i) {
+    char * a = buf + i * Size;
+    char * b = slot1 + i * Size;
+    if (Elem->isFloatTy()) {
+      *(float *) a = 12345.678f;
+      *(float *) b = divisor;
+    }
+    else if (Elem->isDoubleTy()) {
+      *(double *) a = 12345.678;
+      *(double *) b = divisor;
+    }
+    else {
+      memset(a, 0x5A, Size);
+      b[0] = divisor;
+    }
+  }
+  buf[2 * KERNEL_SLOT] = 1;
+}
+
+/// Time the given kernel function and return the robust median of the
+/// nanoseconds spent per call.
+static double timeKernel(ExecutionEngine * EE, Function * F, 
+    const KernelSpec & spec)
+{
+  KernelFn fn = (KernelFn) (intptr_t) EE->getPointerToFunction(F);
+  char * in = NULL;
+  if (posix_memalign((void **) &in, 64, KERNEL_BUFSIZE) != 0)
+    diegrace("Cannot allocate kernel buffer\n");
+  fillBuffer(spec, in);
+  char * out = in + KERNEL_BUFSIZE / 2;
+  for (unsigned i = 0; i < KERNEL_WARMUPS; ++i)
+    fn(iterations, in, out);
+  vector<double> samples;
+  for (unsigned i = 0; i < runs; ++i) {
+    double t1 = now_ns();
+    fn(iterations, in, out);
+    double t2 = now_ns();
+    samples.push_back(t2 - t1);
+  }
+  free(in);
+  return robust_median(samples);
+}
+
+/// Return the nanoseconds of a single operation of the spec.
+static double measure(const KernelSpec & spec)
+{
+  LLVMContext & C = spec.Dst->getContext();
+  Module * M = new Module("calibration", C);
+  Function * kernel = buildKernel(M, spec, false);
+  Function * baseline = buildKernel(M, spec, true);
+  string Err;
+  EngineBuilder builder(M);
+  builder.setErrorStr(&Err);
+  builder.setEngineKind(EngineKind::JIT);
+  builder.setOptLevel(CodeGenOpt::Default);
+  builder.setMCPU(sys::getHostCPUName());
+  ExecutionEngine * EE = builder.create();
+  if (EE == NULL)
+    diegrace("Cannot create JIT: %s\n", Err.c_str());
+  double tk = timeKernel(EE, kernel, spec);
+  double tb = timeKernel(EE, baseline, spec);
+  delete EE; // also owns M
+  double ns = (tk - tb) / ((double) iterations * KERNEL_UNROLL);
+  return ns < 0 ? 0 : ns;
+}
+
+/// Only calibrate types that are legal on the target; costs of
+/// illegal types are derived by the cost model from legal ones.
+static bool isLegal(const VectorTargetTransformStub & VTT, Type * Ty)
+{
+  std::pair<unsigned, MVT> LT = VTT.getTypeLegalizationCost(Ty);
+  return LT.first == 1 && EVT(LT.second).getTypeForEVT(Ty->getContext()) == Ty;
+}
+
+static MVT toMVT(const TargetLowering * TLI, Type * Ty)
+{
+  return TLI->getValueType(Ty).getSimpleVT();
+}
+
+static void calibrate(TargetMachine * TM, CalibratedCostTable & table)
+{
+  LLVMContext & C = getGlobalContext();
+  const TargetLowering * TLI = TM->getTargetLowering();
+  VectorTargetTransformStub VTT(TLI);
+
+  Type * I8 = Type::getInt8Ty(C), * I16 = Type::getInt16Ty(C);
+  Type * I32 = Type::getInt32Ty(C), * I64 = Type::getInt64Ty(C);
+  Type * F32 = Type::getFloatTy(C), * F64 = Type::getDoubleTy(C);
+  Type * Ints[] = { I8, I16, I32, I64,
+    VectorType::get(I8, 16), VectorType::get(I16, 8), VectorType::get(I32, 4),
+    VectorType::get(I64, 2), VectorType::get(I32, 8), VectorType::get(I64, 4) };
+  Type * FPs[] = { F32, F64, VectorType::get(F32, 4), VectorType::get(F64, 2),
+    VectorType::get(F32, 8), VectorType::get(F64, 4) };
+  static const unsigned IntOps[] = { Instruction::Add, Instruction::Sub,
+    Instruction::Mul, Instruction::UDiv, Instruction::SDiv, Instruction::URem,
+    Instruction::SRem, Instruction::Shl, Instruction::LShr, Instruction::AShr,
+    Instruction::And, Instruction::Or, Instruction::Xor };
+  static const unsigned FPOps[] = { Instruction::FAdd, Instruction::FSub,
+    Instruction::FMul, Instruction::FDiv, Instruction::FRem };
+
+  vector<KernelSpec> specs;
+  for (unsigned t = 0; t < array_lengthof(Ints); ++t) {
+    for (unsigned o = 0; o < array_lengthof(IntOps); ++o)
+      specs.push_back(KernelSpec(IntOps[o], ChainShape, Ints[t]));
+    if (!Ints[t]->isVectorTy()) {
+      specs.push_back(KernelSpec(Instruction::ICmp, CmpShape, Ints[t]));
+      specs.push_back(KernelSpec(Instruction::Select, SelectShape, Ints[t]));
+    }
+    specs.push_back(KernelSpec(Instruction::Load, LoadShape, Ints[t]));
+    specs.push_back(KernelSpec(Instruction::Store, StoreShape, Ints[t]));
+  }
+  for (unsigned t = 0; t < array_lengthof(FPs); ++t) {
+    for (unsigned o = 0; o < array_lengthof(FPOps); ++o)
+      specs.push_back(KernelSpec(FPOps[o], ChainShape, FPs[t]));
+    if (!FPs[t]->isVectorTy()) {
+      specs.push_back(KernelSpec(Instruction::FCmp, CmpShape, FPs[t]));
+      specs.push_back(KernelSpec(Instruction::Select, SelectShape, FPs[t]));
+    }
+    specs.push_back(KernelSpec(Instruction::Load, LoadShape, FPs[t]));
+    specs.push_back(KernelSpec(Instruction::Store, StoreShape, FPs[t]));
+  }
+  // Conversions: (opcode, dst, src)
+  specs.push_back(KernelSpec(Instruction::Trunc, CastShape, I32, I64));
+  specs.push_back(KernelSpec(Instruction::Trunc, CastShape, I16, I32));
+  specs.push_back(KernelSpec(Instruction::Trunc, CastShape, I8, I32));
+  specs.push_back(KernelSpec(Instruction::ZExt, CastShape, I32, I8));
+  specs.push_back(KernelSpec(Instruction::ZExt, CastShape, I32, I16));
+  specs.push_back(KernelSpec(Instruction::ZExt, CastShape, I64, I32));
+  specs.push_back(KernelSpec(Instruction::SExt, CastShape, I32, I8));
+  specs.push_back(KernelSpec(Instruction::SExt, CastShape, I32, I16));
+  specs.push_back(KernelSpec(Instruction::SExt, CastShape, I64, I32));
+  specs.push_back(KernelSpec(Instruction::FPToSI, CastShape, I32, F32));
+  specs.push_back(KernelSpec(Instruction::FPToSI, CastShape, I32, F64));
+  specs.push_back(KernelSpec(Instruction::FPToSI, CastShape, I64, F64));
+  specs.push_back(KernelSpec(Instruction::FPToUI, CastShape, I32, F64));
+  specs.push_back(KernelSpec(Instruction::FPToUI, CastShape, I64, F64));
+  specs.push_back(KernelSpec(Instruction::SIToFP, CastShape, F32, I32));
+  specs.push_back(KernelSpec(Instruction::SIToFP, CastShape, F64, I32));
+  specs.push_back(KernelSpec(Instruction::SIToFP, CastShape, F64, I64));
+  specs.push_back(KernelSpec(Instruction::UIToFP, CastShape, F64, I32));
+  specs.push_back(KernelSpec(Instruction::UIToFP, CastShape, F64, I64));
+  specs.push_back(KernelSpec(Instruction::FPTrunc, CastShape, F32, F64));
+  specs.push_back(KernelSpec(Instruction::FPExt, CastShape, F64, F32));
+  specs.push_back(KernelSpec(Instruction::SIToFP, CastShape,
+        VectorType::get(F32, 4), VectorType::get(I32, 4)));
+  specs.push_back(KernelSpec(Instruction::FPToSI, CastShape,
+        VectorType::get(I32, 4), VectorType::get(F32, 4)));
+  specs.push_back(KernelSpec(Instruction::SExt, CastShape,
+        VectorType::get(I64, 4), VectorType::get(I32, 4)));
+  specs.push_back(KernelSpec(Instruction::ZExt, CastShape,
+        VectorType::get(I32, 8), VectorType::get(I16, 8)));
+  specs.push_back(KernelSpec(Instruction::Trunc, CastShape,
+        VectorType::get(I32, 4), VectorType::get(I64, 4)));
+
+  // The unit: a scalar i32 add is TCC_Basic
+  double unit = measure(KernelSpec(Instruction::Add, ChainShape, I32));
+  if (unit <= 0)
+    diegrace("Cannot measure the unit cost, try a larger -n\n");
+  if (verbose)
+    errs() << "unit (add i32): " << unit << " ns\n";
+
+  for (vector<KernelSpec>::iterator I = specs.begin(), E = specs.end(); I != E; ++I) {
+    if (!isLegal(VTT, I->Dst) || (I->Src && !isLegal(VTT, I->Src)))
+      continue;
+    double ns = measure(*I);
+    // A measured operation is never free: an operation lost in the noise
+    // keeps its built-in cost, one cheaper than the unit costs the unit
+    unsigned cost = ns > 0 ? max((unsigned) (ns / unit + 0.5), 1u) : 0;
+    if (verbose) {
+      errs() << Instruction::getOpcodeName(I->Opcode) << " " << *I->Dst;
+      if (I->Src)
+        errs() << " " << *I->Src;
+      errs() << ": " << ns << " ns => ";
+      if (cost)
+        errs() << cost << "\n";
+      else
+        errs() << "not measurable, left out\n";
+    }
+    if (cost == 0)
+      continue;
+    if (I->Src)
+      table.set(I->Opcode, toMVT(TLI, I->Dst), cost, toMVT(TLI, I->Src));
+    else
+      table.set(I->Opcode, toMVT(TLI, I->Dst), cost);
+  }
+}
+
+static char const * option_help[] = {
+  "-o FILE\n\tOutput the cost table to FILE. Default is stdout.",
+  "-n NUM\n\tNumber of loop iterations of each kernel run.\n\tDefault 1048576.",
+  "-r NUM\n\tNumber of timed runs of each kernel.\n\tDefault 21.",
+  "-v\n\tPrint the measured time of every kernel.",
+  "-h\n\tPrint this message.",
+  0
+};
+
+static char const * option_example[] = {
+  "-o data/costs.x86",
+  "-v -r 51 -o data/costs.x86",
+  0
+};
+
+void usage(FILE *fp = stderr)
+{
+  const char **p = option_help;
+  fprintf(fp, "Calibrate the cost model by timing JIT-compiled microkernels on\n");
+  fprintf(fp, "the local machine.\n\n");
+  fprintf(fp, "Usage: %s [OPTIONS]\n\n", program_name);
+  while (*p) {
+    fprintf(fp, "  %s\n\n", *p);
+    p++;
+  }
+  p = option_example;
+  fprintf(fp, "Examples:\n\n");
+  while (*p) {
+    fprintf(fp, "  %s %s\n\n", program_name, *p);
+    p++;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  program_name = argv[0];
+
+  int opt;
+  char *endptr;
+  const char *outname = NULL;
+  while((opt = getopt(argc, argv, "o:n:r:vh")) != -1) {
+    switch(opt) {
+      case 'o':
+        outname = optarg;
+        break;
+      case 'n':
+        iterations = strtoul(optarg, &endptr, 10);
+        if (endptr == optarg || iterations == 0) {
+          fprintf(stderr, "Option %s is not a valid number\n", optarg);
+          exit(1);
+        }
+        break;
+      case 'r':
+        runs = strtoul(optarg, &endptr, 10);
+        if (endptr == optarg || runs == 0) {
+          fprintf(stderr, "Option %s is not a valid number\n", optarg);
+          exit(1);
+        }
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'h':
+        usage();
+        exit(0);
+      case '?':
+      default:
+        usage();
+        exit(1);
+    }
+  }
+  if (optind != argc) {
+    usage();
+    exit(1);
+  }
+
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  InitializeNativeTarget();
+  TargetMachine * TM = getTargetMachine();
+
+  CalibratedCostTable table;
+  calibrate(TM, table);
+
+  string Err;
+  if (outname) {
+    fout = new raw_fd_ostream(outname, Err);
+    if (!Err.empty()) {
+      fprintf(stderr, "Cannot open %s: %s\n", outname, Err.c_str());
+      exit(1);
+    }
+  }
+  else
+    fout = &outs();
+  *fout << "# Calibrated on " << sys::getHostCPUName() << " ("
+        << sys::getHostTriple() << ")\n";
+  table.write(*fout);
+  if (outname)
+    delete fout;
+  return 0;
+}
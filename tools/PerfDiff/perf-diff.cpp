@@ -11,9 +11,19 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <string>
 #include <utility>
+#include <vector>
+#include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include "llvm/LLVMContext.h"
@@ -27,6 +37,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
 
 #include "analyzer/DiffLog.h"
 #include "analyzer/DifferenceEngine.h"
@@ -43,12 +54,253 @@ static Module *ReadModule(LLVMContext &Context, StringRef Name) {
     return M;
 }
 
+/// A pair of modules to compare in batch mode and the result.
+struct DiffJob {
+    std::string LName;
+    std::string RName;
+    std::string Error;
+    std::vector<FunctionDiffResult> Results;
+
+    DiffJob(const std::string &L, const std::string &R) : LName(L), RName(R) {}
+};
+
+static std::vector<DiffJob> Jobs;
+static unsigned NextJob = 0;
+static pthread_mutex_t JobLock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool isModuleFile(const char *name) {
+    const char *ext = strrchr(name, '.');
+    return ext && (strcmp(ext, ".bc") == 0 || strcmp(ext, ".ll") == 0 ||
+                   strcmp(ext, ".s") == 0);
+}
+
+/// Collects the module files under dir, relative to the top directory.
+static void listModules(const std::string &top, const std::string &rel,
+                        std::vector<std::string> &files) {
+    std::string dir = rel.empty() ? top : top + "/" + rel;
+    DIR *d = opendir(dir.c_str());
+    if (d == NULL) {
+        fprintf(stderr, "Cannot open directory %s\n", dir.c_str());
+        exit(1);
+    }
+    struct dirent *dp;
+    while ((dp = readdir(d)) != NULL) {
+        if (dp->d_name[0] == '.')
+            continue;
+        std::string name = rel.empty() ? dp->d_name : rel + "/" + dp->d_name;
+        struct stat st;
+        if (stat((top + "/" + name).c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            listModules(top, name, files);
+        else if (isModuleFile(dp->d_name))
+            files.push_back(name);
+    }
+    closedir(d);
+}
+
+/// Pairs the modules with the same relative path in the two directories.
+static void addDirJobs(const char *ldir, const char *rdir) {
+    std::vector<std::string> files;
+    listModules(ldir, "", files);
+    std::sort(files.begin(), files.end());
+    for (std::vector<std::string>::iterator I = files.begin(), E = files.end();
+         I != E; ++I) {
+        std::string r = std::string(rdir) + "/" + *I;
+        if (access(r.c_str(), R_OK) != 0) {
+            fprintf(stderr, "%s exists only in %s\n", I->c_str(), ldir);
+            continue;
+        }
+        Jobs.push_back(DiffJob(std::string(ldir) + "/" + *I, r));
+    }
+}
+
+/// Reads the pairs of modules from a manifest, one pair per line.
+static void addManifestJobs(const char *fname) {
+    FILE *fp = fopen(fname, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open manifest %s\n", fname);
+        exit(1);
+    }
+    char line[2 * PATH_MAX];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lineno++;
+        char *p = line;
+        while (isspace(*p)) p++;
+        if (*p == '\0' || *p == '#')
+            continue;
+        // Split the line in place, so no token can outgrow its buffer
+        char *l = p;
+        while (*p != '\0' && !isspace(*p)) p++;
+        while (isspace(*p)) *p++ = '\0';
+        char *r = p;
+        while (*p != '\0' && !isspace(*p)) p++;
+        *p = '\0';
+        if (*r == '\0') {
+            fprintf(stderr, "Syntax error at line %d of %s\n", lineno, fname);
+            exit(1);
+        }
+        Jobs.push_back(DiffJob(l, r));
+    }
+    fclose(fp);
+}
+
+/// Worker of the thread pool, each owning an LLVMContext.
+static void *diffWorker(void *arg) {
+    LLVMContext Context;
+    while (true) {
+        pthread_mutex_lock(&JobLock);
+        unsigned i = NextJob++;
+        pthread_mutex_unlock(&JobLock);
+        if (i >= Jobs.size())
+            break;
+        DiffJob &Job = Jobs[i];
+        SMDiagnostic Diag;
+        Module *LModule = ParseIRFile(Job.LName, Diag, Context);
+        if (!LModule) {
+            Job.Error = "cannot load " + Job.LName;
+            continue;
+        }
+        Module *RModule = ParseIRFile(Job.RName, Diag, Context);
+        if (!RModule) {
+            Job.Error = "cannot load " + Job.RName;
+            delete LModule;
+            continue;
+        }
+        // Only whether each function changed is reported
+        SummaryConsumer Consumer(LModule->size());
+        DifferenceEngine Engine(Context, Consumer);
+        Engine.summarize(LModule, RModule, Job.Results);
+        delete LModule;
+        delete RModule;
+    }
+    return NULL;
+}
+
+/// Prints the per-function summary, returns whether there were differences.
+static bool printSummary(DiffJob &Job) {
+    if (!Job.Error.empty()) {
+        printf("%s %s: error, %s\n", Job.LName.c_str(), Job.RName.c_str(),
+               Job.Error.c_str());
+        return true;
+    }
+    unsigned counts[FunctionRemoved + 1];
+    memset(counts, 0, sizeof(counts));
+    for (std::vector<FunctionDiffResult>::iterator I = Job.Results.begin(),
+         E = Job.Results.end(); I != E; ++I)
+        counts[I->Kind]++;
+    printf("%s %s: %u identical, %u renamed, %u changed, %u added, %u removed\n",
+           Job.LName.c_str(), Job.RName.c_str(), counts[FunctionIdentical],
+           counts[FunctionRenamed], counts[FunctionChanged],
+           counts[FunctionAdded], counts[FunctionRemoved]);
+    for (std::vector<FunctionDiffResult>::iterator I = Job.Results.begin(),
+         E = Job.Results.end(); I != E; ++I) {
+        switch (I->Kind) {
+            case FunctionIdentical:
+                break;
+            case FunctionAdded:
+                printf("  %s %s\n", toFunctionDiffStr(I->Kind), I->RName.c_str());
+                break;
+            default:
+                // Renamed, or changed and renamed
+                if (!I->RName.empty() && I->RName != I->LName)
+                    printf("  %s %s -> %s\n", toFunctionDiffStr(I->Kind),
+                           I->LName.c_str(), I->RName.c_str());
+                else
+                    printf("  %s %s\n", toFunctionDiffStr(I->Kind), I->LName.c_str());
+                break;
+        }
+    }
+    return counts[FunctionIdentical] != Job.Results.size();
+}
+
+static int runBatch(unsigned nthreads) {
+    if (nthreads > Jobs.size())
+        nthreads = Jobs.size();
+    if (nthreads == 0)
+        return 0;
+    llvm_start_multithreaded();
+    std::vector<pthread_t> threads(nthreads);
+    for (unsigned i = 0; i < nthreads; ++i) {
+        if (pthread_create(&threads[i], NULL, diffWorker, NULL) != 0) {
+            fprintf(stderr, "Cannot create worker thread\n");
+            exit(1);
+        }
+    }
+    for (unsigned i = 0; i < nthreads; ++i)
+        pthread_join(threads[i], NULL);
+    llvm_stop_multithreaded();
+
+    bool differences = false;
+    for (std::vector<DiffJob>::iterator I = Jobs.begin(), E = Jobs.end();
+         I != E; ++I)
+        if (printSummary(*I))
+            differences = true;
+    return differences;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Compare two modules and check if there are _literally_ equivalent.\n\n");
+    fprintf(stderr, "Usage: %s module1 module2\n", program);
+    fprintf(stderr, "       %s [-j N] -d dir1 dir2\n", program);
+    fprintf(stderr, "       %s [-j N] -m MANIFEST\n\n", program);
+    fprintf(stderr, "  -d\n\tCompare the modules with the same path under the two directories.\n\n");
+    fprintf(stderr, "  -m MANIFEST\n\tCompare the pairs of modules listed in MANIFEST, one pair per line.\n\n");
+    fprintf(stderr, "  -j N\n\tNumber of worker threads in batch mode, default to the number of cores.\n\n");
+    fprintf(stderr, "In batch mode, a summary of identical, renamed, changed, added and\n");
+    fprintf(stderr, "removed functions is printed for each pair.\n\n");
+}
+
 int main(int argc, char **argv) {
-    if (argc <= 2) {
-        fprintf(stderr, "Compare two modules and check if there are _literally_ equivalent.\n\n");
-        fprintf(stderr, "Usage: %s module1 module2\n\n", argv[0]);
+    bool dirmode = false;
+    char *manifest = NULL;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0)
+        nthreads = 1;
+    int opt;
+    char *endptr;
+    while ((opt = getopt(argc, argv, "dhj:m:")) != -1) {
+        switch (opt) {
+            case 'd':
+                dirmode = true;
+                break;
+            case 'j':
+                nthreads = strtol(optarg, &endptr, 10);
+                if (endptr == optarg || nthreads <= 0) {
+                    fprintf(stderr, "Number of threads must be positive integer\n");
+                    exit(1);
+                }
+                break;
+            case 'm':
+                manifest = optarg;
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            case '?':
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+
+    if (manifest) {
+        if (optind != argc) {
+            usage(argv[0]);
+            exit(1);
+        }
+        addManifestJobs(manifest);
+        return runBatch(nthreads);
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
         exit(1);
     }
+    if (dirmode) {
+        addDirJobs(argv[optind], argv[optind + 1]);
+        return runBatch(nthreads);
+    }
 
     LLVMContext Context;
 
@@ -56,8 +308,8 @@ int main(int argc, char **argv) {
     gettimeofday(&tim, NULL);
     double t1 = tim.tv_sec * 1000.0 +(tim.tv_usec/1000.0);
     // Load both modules.  Die if that fails.
-    Module *LModule = ReadModule(Context, argv[1]);
-    Module *RModule = ReadModule(Context, argv[2]);
+    Module *LModule = ReadModule(Context, argv[optind]);
+    Module *RModule = ReadModule(Context, argv[optind + 1]);
     gettimeofday(&tim, NULL);
     double t2 = tim.tv_sec * 1000.0 +(tim.tv_usec/1000.0);
     fprintf(stderr, "%.4lf ms\n", t2-t1);
@@ -65,7 +317,7 @@ int main(int argc, char **argv) {
 
     gettimeofday(&tim, NULL);
     t1 = tim.tv_sec * 1000.0 +(tim.tv_usec/1000.0);
-    DiffConsumer Consumer(LModule, RModule);
+    SummaryConsumer Consumer(LModule->size());
     DifferenceEngine Engine(Context, Consumer);
 
     Engine.diff(LModule, RModule);
@@ -73,6 +325,15 @@ int main(int argc, char **argv) {
     t2 = tim.tv_sec * 1000.0 +(tim.tv_usec/1000.0);
     fprintf(stderr, "%.4lf ms\n", t2-t1);
 
+    const std::vector<FunctionDiffCount> &Counts = Consumer.getCounts();
+    for (std::vector<FunctionDiffCount>::const_iterator I = Counts.begin(),
+         E = Counts.end(); I != E; ++I) {
+        if (I->Differences) {
+            fprintf(stderr, "first difference in %s\n", I->L->getName().str().c_str());
+            break;
+        }
+    }
+
     delete LModule;
     delete RModule;
 
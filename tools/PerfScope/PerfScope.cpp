@@ -2,6 +2,7 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <getopt.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -40,7 +41,12 @@
 #include "commons/LLVMHelper.h"
 #include "parser/PatchDecoder.h"
 #include "mapper/Matcher.h"
+#include "analyzer/CostSummary.h"
+#include "analyzer/DifferenceEngine.h"
 #include "analyzer/Evaluator.h"
+#include "analyzer/FunctionSimilarity.h"
+#include "analyzer/HotInfluence.h"
+#include "analyzer/LibCallCost.h"
 #include "analyzer/X86CostModel.h"
 #include "llvmslicer/StaticSlicer.h"
 
@@ -71,6 +77,21 @@ static char * program_name;
 
 static char * id_fname = NULL;
 
+static char * cost_table = NULL;
+
+static char * slicer_cache = NULL;
+
+static int slicer_threads = 0;
+
+// Deadline of the analysis in ms since the epoch, 0 for no time budget
+static double deadline = 0;
+// Whether the deadline passed, making the rest of the results partial
+static bool budget_exhausted = false;
+
+static bool hot_influence = false;
+
+static LibCallCostDB libcalls;
+
 static LLVMContext & Context = getGlobalContext();
 
 static vector<ModuleArg> newmods;
@@ -78,6 +99,22 @@ static vector<ModuleArg> oldmods;
 
 static Profile profile;
 
+// Touched functions and their before-revision versions
+static map<Function *, Function *> oldfuncs;
+
+Function * getOldFunction(Function * func)
+{
+  map<Function *, Function *>::iterator it = oldfuncs.find(func);
+  if (it == oldfuncs.end())
+    return NULL;
+  return it->second;
+}
+
+// Functions of the before-revision modules that no longer exist under
+// the same name in the after-revision modules, indexed on first use
+static SimilarityIndex oldindex;
+static bool oldindexed = false;
+
 typedef RiskEvaluator::InstVecTy InstVecTy;
 typedef RiskEvaluator::InstMapTy InstMapTy;
 
@@ -86,25 +123,273 @@ static char objname[MAX_PATH];
 
 X86CostModel * XCM = NULL;
 
-void runevaluator(Module * module, InstMapTy & instmap)
+bool pastDeadline()
 {
+  if (deadline <= 0)
+    return false;
+  if (!budget_exhausted) {
+    struct timeval tim;
+    gettimeofday(&tim, NULL);
+    budget_exhausted = tim.tv_sec * 1000.0 + (tim.tv_usec/1000.0) > deadline;
+  }
+  return budget_exhausted;
+}
+
+// Compare the cost of the touched functions with their before-revision
+// versions. Modifications in functions that cost no more than before 
+// are at most low risk.
+void calcCostDelta(Module * module, InstMapTy & instmap, RiskEvaluator * evaluator)
+{
+  CostSummaryMapTy before, after;
+  FunctionPassManager FPM(module);
+  FPM.add(new CostSummaryPass(XCM, &profile, after));
+  FPM.doInitialization();
+  for (InstMapTy::iterator map_it = instmap.begin(), map_ie = instmap.end();
+      map_it != map_ie; ++map_it) {
+    // Without the comparison the modifications are simply not capped
+    if (pastDeadline())
+      break;
+    Function * old = getOldFunction(map_it->first);
+    if (old == NULL)
+      continue;
+    FPM.run(*(map_it->first));
+    FunctionPassManager OldFPM(old->getParent());
+    OldFPM.add(new CostSummaryPass(XCM, &profile, before));
+    OldFPM.doInitialization();
+    OldFPM.run(*old);
+    OldFPM.doFinalization();
+    const FunctionCostSummary & b = before[old];
+    const FunctionCostSummary & a = after[map_it->first];
+    printCostDelta(cpp_demangle(map_it->first->getName().data()), b, a);
+    if (a.noWorseThan(b))
+      evaluator->setRiskCap(map_it->first, LowRisk);
+    else if (a.CodeSize > b.CodeSize)
+      evaluator->setCodeGrowth(map_it->first, a.CodeSize - b.CodeSize, 
+          lostInlineThreshold(b, a) != NULL);
+  }
+  FPM.doFinalization();
+}
+
+void runevaluator(Module * module, InstMapTy & instmap, bool removed = false)
+{
+  // Nothing left to evaluate, e.g., all the changes are refactorings,
+  // so none of the module-wide analyses is needed either
+  if (instmap.empty())
+    return;
   slicing::StaticSlicer * slicer = NULL;
   PassManager Passes;
-  if (analysis_level > 1) {
-    slicer = new slicing::StaticSlicer(true);
+  // Past the deadline the module-wide points-to and mod sets are not
+  // even started, the modifications are only assessed as with -L1
+  int level = analysis_level;
+  if (level > 1 && pastDeadline())
+    level = 1;
+  if (level > 1) {
+    // -L2 slices with the cheap union-find points-to sets, -L3 and above
+    // with the inclusion-based ones, -L4 and above through summary edges
+    slicer = new slicing::StaticSlicer(true, level > 2 ?
+        slicing::PTM_INCLUSION : slicing::PTM_UNIFICATION);
+    slicer->setSummaryEdges(level > 3);
+    if (slicer_cache)
+      slicer->setCacheDir(slicer_cache);
+    if (slicer_threads)
+      slicer->setThreads(slicer_threads);
+    slicer->setDeadline(deadline);
     Passes.add(slicer);
     Passes.run(*module);
   }
+  // What the hot loops and branches of the module depend on, sliced once
+  // and kept for all the functions
+  OwningPtr<HotInfluence> influence;
+  if (slicer && hot_influence && !pastDeadline()) {
+    influence.reset(new HotInfluence(module, slicer, &profile));
+    fprintf(stderr, "%u hot conditions depend on %u instructions%s\n",
+        influence->getNumConditions(), influence->size(), 
+        influence->isPartial() ? " (partial)" : "");
+  }
   assert(XCM && "requires cost model");
-  if (instmap.size()) {
-    OwningPtr<FunctionPassManager> FPasses(new FunctionPassManager(module));
-    FPasses->add(new RiskEvaluator(instmap, slicer, XCM, &profile, module, analysis_level));
-    FPasses->doInitialization();
-    for (InstMapTy::iterator map_it = instmap.begin(), map_ie = instmap.end();
-        map_it != map_ie; ++map_it) {
-      FPasses->run(*(map_it->first));
+  RiskEvaluator * evaluator = new RiskEvaluator(instmap, slicer, XCM, &profile, 
+      module, level);
+  evaluator->setRemoved(removed);
+  evaluator->setDeadline(deadline);
+  evaluator->setHotInfluence(influence.get());
+  if (!oldmods.empty() && !removed)
+    calcCostDelta(module, instmap, evaluator);
+  // Changes missing from a partial influence set go unflagged
+  if (budget_exhausted || (influence && influence->isPartial()))
+    evaluator->setPartial();
+  OwningPtr<FunctionPassManager> FPasses(new FunctionPassManager(module));
+  // Removed code is evaluated in one of the before-revision modules, so
+  // it would only be compared with itself
+  for (vector<ModuleArg>::iterator it = oldmods.begin(), ie = oldmods.end();
+      it != ie && !removed; ++it) {
+    if (it->module)
+      evaluator->addBaseModule(it->module);
+  }
+  FPasses->add(evaluator);
+  FPasses->doInitialization();
+  for (InstMapTy::iterator map_it = instmap.begin(), map_ie = instmap.end();
+      map_it != map_ie; ++map_it) {
+    FPasses->run(*(map_it->first));
+  }
+  FPasses->doFinalization();
+}
+
+// Whether an old function has no definition of the same name in the
+// after-revision modules, i.e., it may have been renamed or moved
+bool isRemoved(Function * old)
+{
+  for (vector<ModuleArg>::iterator it = newmods.begin(), ie = newmods.end();
+      it != ie; ++it) {
+    if (it->module == NULL)
+      continue;
+    Function * func = it->module->getFunction(old->getName());
+    if (func && !func->isDeclaration())
+      return false;
+  }
+  return true;
+}
+
+// Find the before-revision version of a function, first by its
+// symbol name, then by the source name and line in the debug info
+// of the same source file, e.g., for renamed static functions, and
+// last by similarity, e.g., for functions renamed or moved to
+// another file.
+Function * matchOldFunction(Function * func, const DISPCopy & sp, 
+    const string & fullname)
+{
+  for (vector<ModuleArg>::iterator it = oldmods.begin(), ie = oldmods.end();
+      it != ie; ++it) {
+    if (it->module == NULL)
+      continue;
+    Function * old = it->module->getFunction(func->getName());
+    if (old && !old->isDeclaration())
+      return old;
+  }
+  for (vector<ModuleArg>::iterator it = oldmods.begin(), ie = oldmods.end();
+      it != ie; ++it) {
+    if (it->module == NULL)
+      continue;
+    Matcher matcher(*(it->module), it->strips, patch_strip_len);
+    Function * best = NULL;
+    unsigned bestdist = UINT_MAX;
+    for (Matcher::sp_iterator I = matcher.resetTarget(fullname), 
+        E = matcher.sp_end(); I != E; ++I) {
+      if (I->filename != sp.filename || I->name != sp.name || 
+          I->function == NULL || I->function->isDeclaration())
+        continue;
+      unsigned dist = I->linenumber > sp.linenumber ? 
+        I->linenumber - sp.linenumber : sp.linenumber - I->linenumber;
+      if (dist < bestdist) {
+        best = I->function;
+        bestdist = dist;
+      }
+    }
+    if (best)
+      return best;
+  }
+  if (!oldindexed) {
+    for (vector<ModuleArg>::iterator it = oldmods.begin(), ie = oldmods.end();
+        it != ie; ++it) {
+      if (it->module == NULL)
+        continue;
+      for (Module::iterator I = it->module->begin(), E = it->module->end(); 
+          I != E; ++I) {
+        // Functions that still exist are paired by name; indexing them
+        // would let a new copy of one pass as its renamed version
+        if (isRemoved(I))
+          oldindex.insert(I);
+      }
+    }
+    oldindexed = true;
+  }
+  return oldindex.findClosest(func, false);
+}
+
+// Whether the IR of a function is equivalent to its before-revision version
+bool isEquivalent(Function * old, Function * func)
+{
+  if (old == NULL || func == NULL || func->isDeclaration())
+    return false;
+  SummaryConsumer consumer(1);
+  DifferenceEngine engine(Context, consumer);
+  engine.diff(old, func);
+  return !consumer.hadDifferences();
+}
+
+// Filter out the functions whose changes are insignificant, e.g.,
+// renaming or formatting
+void filterEquivalent(InstMapTy & instmap)
+{
+  for (InstMapTy::iterator map_it = instmap.begin(); map_it != instmap.end(); ) {
+    // The functions left are evaluated as changed
+    if (pastDeadline())
+      break;
+    if (isEquivalent(getOldFunction(map_it->first), map_it->first)) {
+      perf_debug("equivalent IR: %s\n", map_it->first->getName().data());
+      instmap.erase(map_it++);
+    }
+    else
+      ++map_it;
+  }
+}
+
+// Same as above for the functions in the before-revision module
+void filterEquivalentOld(InstMapTy & oldinstmap, Module * module)
+{
+  for (InstMapTy::iterator map_it = oldinstmap.begin(); map_it != oldinstmap.end(); ) {
+    if (pastDeadline())
+      break;
+    Function * func = module->getFunction(map_it->first->getName());
+    if (isEquivalent(map_it->first, func)) {
+      perf_debug("equivalent IR: %s\n", map_it->first->getName().data());
+      oldinstmap.erase(map_it++);
+    }
+    else
+      ++map_it;
+  }
+}
+
+// Map the DEL modifications and the old side of REP modifications of
+// a hunk into the before-revision module. It mirrors the mapping of
+// the new side in analyze().
+void mapOldHunk(Matcher & matcher, Matcher::sp_iterator & I, inst_iterator & fi,
+    Function *& prevfunc, Hunk * hunk, InstMapTy & instmap)
+{
+  Scope scope = hunk->enclosing_scope;
+  Hunk::iterator HI = hunk->begin(), HE = hunk->end();
+  bool multiple = true;
+  Function * func = NULL;
+  for(; multiple; prevfunc = func) {
+    func = matcher.matchFunction(I, scope, multiple);
+    if (func == NULL)
+      break;
+    // Skip ADD modifications and modifications that are 
+    // before function's beginning
+    while(HI != HE && ((*HI)->type == ADD || 
+          (*HI)->scope.end < I->linenumber))
+      HI++;
+    if (HI == HE)
+      break;
+    if (prevfunc != func)
+      fi = inst_begin(func);
+    for (; HI != HE && (*HI)->scope.begin <= I->lastline; ++HI) {
+      if ((*HI)->type == ADD)
+        continue;
+      Scope & del_scope = (*HI)->scope; 
+      if (del_scope.begin < I->linenumber)
+        del_scope.begin = I->linenumber;
+      if (del_scope.end > I->lastline)
+        del_scope.end = I->lastline;
+      Instruction *inst;
+      bool found_inst = false;
+      while ( (inst = matcher.matchInstruction(fi, func, del_scope)) != NULL) {
+        instmap[func].push_back(inst);
+        found_inst = true;
+      } 
+      if (!found_inst) 
+        perf_debug("Can't locate any removed instruction for mod @[#%lu, #%lu]\n",
+           del_scope.begin, del_scope.end); 
     }
-    FPasses->doFinalization();
   }
 }
 
@@ -156,6 +441,12 @@ void analyze(char *input)
   initPassRegistry(Registry);
 
   XCM = new X86CostModel(getTargetMachine());
+  if (cost_table && !XCM->loadCostTable(cost_table)) {
+    fprintf(stderr, "Ill-formated cost table.\n");
+    exit(1);
+  }
+  if (!libcalls.empty())
+    XCM->setLibCallCostDB(&libcalls);
   PatchDecoder * decoder = new PatchDecoder(input);
   assert(decoder);
   Patch *patch = NULL;
@@ -184,6 +475,25 @@ void analyze(char *input)
           Function *func = NULL;
           Function *prevfunc = NULL;
           InstMapTy instmap;
+          // The old side of the hunks in the before-revision module
+          OwningPtr<Matcher> oldmatcher;
+          Module * oldmodule = NULL;
+          Matcher::sp_iterator OI;
+          inst_iterator ofi;
+          Function *prevoldfunc = NULL;
+          InstMapTy oldinstmap;
+          for (vector<ModuleArg>::iterator oit = oldmods.begin(), oie = oldmods.end();
+              oit != oie; ++oit) {
+            if (oit->module == NULL)
+              continue;
+            oldmatcher.reset(new Matcher(*(oit->module), oit->strips, patch_strip_len));
+            OI = oldmatcher->resetTarget(chap->fullname);
+            if (OI != oldmatcher->sp_end()) {
+              oldmodule = oit->module;
+              break;
+            }
+            oldmatcher.reset();
+          }
 #ifdef NEED_MEM2REG
           OwningPtr<FunctionPassManager> Mem2RegPass(new FunctionPassManager(it->module));
           Mem2RegPass->add(createPromoteMemoryToRegisterPass());
@@ -201,6 +511,8 @@ void analyze(char *input)
               func = matcher.matchFunction(I, scope, multiple);
               if (func == NULL)
                 break;
+              if (!oldmods.empty() && !oldfuncs.count(func))
+                oldfuncs[func] = matchOldFunction(func, *I, chap->fullname);
 #ifdef NEED_MEM2REG
               if (prevfunc != func) // Only transform the new functions
                 Mem2RegPass->run(*func);
@@ -287,12 +599,30 @@ void analyze(char *input)
               }
               perf_debug("$$\n");
             }
+            if (oldmatcher.get())
+              mapOldHunk(*oldmatcher, OI, ofi, prevoldfunc, hunk, oldinstmap);
             if (s == 0)
               perf_debug("insignificant scope\n");
-            else
+            else if (oldmods.empty())
+              insignificant = false;
+          }
+          // With the before-revision modules, only the functions whose
+          // IR actually changed are significant
+          if (!oldmods.empty()) {
+            filterEquivalent(instmap);
+            if (!instmap.empty())
               insignificant = false;
           }
           runevaluator(it->module, instmap);
+          // Removed code is evaluated in its old context, e.g., the loss
+          // of a fast path in front of expensive work
+          if (oldmodule) {
+            filterEquivalentOld(oldinstmap, it->module);
+            if (!oldinstmap.empty()) {
+              insignificant = false;
+              runevaluator(oldmodule, oldinstmap, true);
+            }
+          }
 #ifdef NEED_MEM2REG
           Mem2RegPass->doFinalization();
 #endif
@@ -312,7 +642,10 @@ void analyze(char *input)
 
 static char const * option_help[] =
 {
-  "-b FILE1,FILE2,...\n\tA comma separated list of bc files from before-revision source code.",
+  "-b FILE1,FILE2,...\n\tA comma separated list of bc files from before-revision source code.\n\t\t"
+             "Changed functions whose IR is equivalent to the before-revision are filtered out,\n\t\t"
+             "the cost of the others is compared with the before-revision, and the\n\t\t"
+             "deleted code is evaluated in the before-revision.",
   "-a FILE1,FILE2,...\n\tA comma separated list of bc files from after-revision source code.",
   "-p LEN\n\tLevel of components to be striped of the path inside the patch file.",
   "-m LEN\n\tLevel of components to be striped of the path inside the module file.",
@@ -331,7 +664,20 @@ static char const * option_help[] =
              "\n\t\t"
              PROFILE_SEGMENT_END 
              "\n\t\tFUNCTION NAME\n\t\t...",
-  "-L LEVEL\n\tSpecify the level of analysis",
+  "-L LEVEL\n\tSpecify the level of analysis. 2 adds slicing with unification-based points-to sets,\n"
+    "\t3 slices with inclusion-based points-to sets, which are more precise but slower.\n"
+    "\t4 also crosses calls through per-function summaries, keeping the slice to the calling\n"
+    "\tcontexts it came from.",
+  "-c FILE\n\tCost table generated by costcalib to override the built-in cost model.",
+  "-C DIR\n\tDirectory to cache the slicer's points-to sets, mod sets and call edges in.\n\t\t"
+             "They are reused by later runs on the same module.",
+  "-j N\n\tNumber of threads slicing the functions of the module, default to the number of cores.",
+  "-l FILE\n\tCost database of bulk-memory intrinsics and libc routines, e.g., data/libcalls.",
+  "-H\n\tAlso flag the changes that hot loop bounds and hot branch conditions depend on, found by\n\t\t"
+             "slicing backward from them once per module. Requires -L2 or above.",
+  "--budget=MS\n\tTime budget of the whole run in milliseconds. The most promising work is done\n\t\t"
+             "first, and when the budget runs out the risk found so far is reported as partial.\n\t\t"
+             "Modules reached past the budget are only assessed as with -L1.",
   "-h\n\tPrint this message.",
   0
 };
@@ -370,17 +716,58 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
+  struct timeval stim;
+  gettimeofday(&stim, NULL);
+  double start = stim.tv_sec * 1000.0 + (stim.tv_usec/1000.0);
+
+  static struct option long_options[] = {
+    {"budget", required_argument, NULL, 'B'},
+    {NULL, 0, NULL, 0}
+  };
   int opt;
   int plen;
+  double budget;
   char *endptr;
-  while((opt = getopt(argc, argv, "a:b:e:hl:s:p:m:L:")) != -1) {
+  while((opt = getopt_long(argc, argv, "a:b:c:C:e:hHj:l:s:p:m:L:", long_options,
+          NULL)) != -1) {
     switch(opt) {
+      case 'B':
+      {
+        budget = strtod(optarg, &endptr);
+        if (endptr == optarg || budget <= 0) {
+          fprintf(stderr, "Time budget must be a positive number of ms\n");
+          exit(1);
+        }
+        deadline = start + budget;
+        break;
+      }
       case 'a':
         parseList(newmods, optarg, ",");
         break;
       case 'b':
         parseList(oldmods, optarg, ",");
         break;
+      case 'c':
+        cost_table = optarg;
+        break;
+      case 'C':
+        slicer_cache = optarg;
+        break;
+      case 'j':
+      {
+        slicer_threads = strtol(optarg, &endptr, 10);
+        if (endptr == optarg || slicer_threads <= 0) {
+          fprintf(stderr, "Number of threads must be positive integer\n");
+          exit(1);
+        }
+        break;
+      }
+      case 'l':
+        if (!libcalls.load(optarg)) {
+          fprintf(stderr, "Ill-formated libcall cost database.\n");
+          exit(1);
+        }
+        break;
       case 'e':
       {
         if (!parseProfile(optarg, profile)) {
@@ -420,6 +807,9 @@ int main(int argc, char *argv[])
       case 'h':
         usage();
         exit(0);
+      case 'H':
+        hot_influence = true;
+        break;
       case 'L':
       {
         analysis_level = atoi(optarg);
@@ -40,6 +40,7 @@
 #include "commons/handy.h"
 #include "commons/CallSiteFinder.h"
 #include "analyzer/Evaluator.h"
+#include "analyzer/LibCallCost.h"
 #include "analyzer/X86CostModel.h"
 
 
@@ -59,6 +60,10 @@ FILE * fout = stdout;
 bool detail = false;
 bool printall = false;
 
+static char * cost_table = NULL;
+
+static LibCallCostDB libcalls;
+
 
 #define PROFILE_DEBUG
 
@@ -166,6 +171,8 @@ static char const * option_help[] = {
   "-d\n\tInclude the cost/hotness detail along with the function name",
   "-n NUM\n\tThe top NUM expensive functions to be printed.\n\tDefault 50. Negative NUM means print all.",
   "-m NUM\n\tThe top NUM hot functions to be printed.\n\tDefault 50. Negative NUM means print all.",
+  "-c FILE\n\tCost table generated by costcalib to override the built-in cost model.",
+  "-l FILE\n\tCost database of bulk-memory intrinsics and libc routines, e.g., data/libcalls.",
   "-h\n\tPrint this message.",
   0
 };
@@ -202,7 +209,7 @@ int main(int argc, char *argv[])
   }
   int opt;
   char *endptr;
-  while((opt = getopt(argc, argv, "adn:m:o:h")) != -1) {
+  while((opt = getopt(argc, argv, "adn:m:o:c:l:h")) != -1) {
     switch(opt) {
       case 'd':
         detail = true;
@@ -231,6 +238,15 @@ int main(int argc, char *argv[])
           exit(1);
         }
         break;
+      case 'c':
+        cost_table = optarg;
+        break;
+      case 'l':
+        if (!libcalls.load(optarg)) {
+          fprintf(stderr, "Ill-formated libcall cost database.\n");
+          exit(1);
+        }
+        break;
       case 'h':
         usage();
         exit(0);
@@ -259,6 +275,12 @@ int main(int argc, char *argv[])
   initPassRegistry(Registry);
 
   X86CostModel * XCM = new X86CostModel(getTargetMachine());
+  if (cost_table && !XCM->loadCostTable(cost_table)) {
+    fprintf(stderr, "Ill-formated cost table.\n");
+    exit(1);
+  }
+  if (!libcalls.empty())
+    XCM->setLibCallCostDB(&libcalls);
   static_profile(module, XCM);
   if (XCM == NULL)
     delete XCM;